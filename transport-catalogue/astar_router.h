@@ -0,0 +1,343 @@
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "router_engine.h"
+#include "snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Поиск A* от точки до точки. Нижняя оценка расстояния до цели — максимум
+// из внешней эвристики (например, по координатам) и оценки ALT по ориентирам
+// (landmarks): для ориентира L и неравенства треугольника
+//   d(v, t) >= d(L, t) - d(L, v)  и  d(v, t) >= d(v, L) - d(t, L).
+// Эвристика должна быть согласованной, иначе маршрут может оказаться не кратчайшим.
+template <typename Weight>
+class AStarRouter : public RouterEngine<Weight> {
+private:
+    using Graph = CsrGraph<Weight>;
+
+public:
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+    using SearchStats = typename RouterEngine<Weight>::SearchStats;
+    using EdgeWeightChange = typename RouterEngine<Weight>::EdgeWeightChange;
+    using RepairStats = typename RouterEngine<Weight>::RepairStats;
+    // Нижняя оценка веса пути от vertex до target
+    using Heuristic = std::function<Weight(VertexId vertex, VertexId target)>;
+
+    // landmark_count ориентиров выбираются жадно: каждый следующий — самая
+    // далёкая от уже выбранных достижимая вершина
+    AStarRouter(const Graph& graph, Heuristic heuristic, size_t landmark_count);
+
+    // Ориентиры и расстояния до них из снимка, без поисков от ориентиров.
+    // heuristic не сохраняется, её передаёт вызывающий
+    AStarRouter(const Graph& graph, Heuristic heuristic, snapshot::Reader& reader);
+
+    void Save(snapshot::Writer& writer) const;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+    SearchStats GetSearchStats() const override;
+
+    // Расстояния до ориентиров пересчитываются, сами ориентиры остаются прежними.
+    // Допустимость heuristic при новых весах — забота вызывающего
+    RepairStats RepairAfterWeightChanges(const std::vector<EdgeWeightChange>& changes) override;
+
+    // Замена внешней эвристики, например после смены весов, от которых она зависит
+    void SetHeuristic(Heuristic heuristic) {
+        heuristic_ = std::move(heuristic);
+    }
+
+    const std::vector<VertexId>& GetLandmarks() const {
+        return landmarks_;
+    }
+
+private:
+    struct QueueItem {
+        Weight estimate;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return estimate > other.estimate;
+        }
+    };
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    struct QueryWorkspace {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<bool> settled;
+        std::vector<VertexId> touched;
+
+        void Prepare(size_t vertex_count) {
+            if (weights.size() < vertex_count) {
+                weights.resize(vertex_count, INFINITE_WEIGHT);
+                prev_edges.resize(vertex_count, NO_EDGE);
+                settled.resize(vertex_count, false);
+            }
+        }
+
+        void Reset() {
+            for (const VertexId vertex : touched) {
+                weights[vertex] = INFINITE_WEIGHT;
+                prev_edges[vertex] = NO_EDGE;
+                settled[vertex] = false;
+            }
+            touched.clear();
+        }
+    };
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    const Graph& graph_;
+    Heuristic heuristic_;
+    std::vector<VertexId> landmarks_;
+    // weights_from_landmarks_[i][v] = d(L_i, v), weights_to_landmarks_[i][v] = d(v, L_i)
+    std::vector<std::vector<Weight>> weights_from_landmarks_;
+    std::vector<std::vector<Weight>> weights_to_landmarks_;
+
+    mutable std::atomic<size_t> query_count_ = 0;
+    mutable std::atomic<size_t> settled_count_ = 0;
+
+    std::vector<Weight> ComputeWeights(const Graph& graph, VertexId source) const;
+    void SelectLandmarks(size_t landmark_count);
+    Weight EstimateWeight(VertexId vertex, VertexId target) const;
+};
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, Heuristic heuristic, size_t landmark_count)
+    : graph_(graph)
+    , heuristic_(std::move(heuristic))
+{
+    for (size_t arc = 0; arc < graph.GetEdgeCount(); ++arc) {
+        if (graph.GetArcWeight(arc) < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    SelectLandmarks(std::min(landmark_count, graph.GetVertexCount()));
+}
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, Heuristic heuristic, snapshot::Reader& reader)
+    : graph_(graph)
+    , heuristic_(std::move(heuristic))
+    , landmarks_(reader.ReadVector<VertexId>())
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    for (const VertexId landmark : landmarks_) {
+        if (landmark >= vertex_count) {
+            throw snapshot::FormatError("Landmark is out of range in snapshot");
+        }
+        weights_from_landmarks_.push_back(reader.ReadVector<Weight>());
+        weights_to_landmarks_.push_back(reader.ReadVector<Weight>());
+        if (weights_from_landmarks_.back().size() != vertex_count || weights_to_landmarks_.back().size() != vertex_count) {
+            throw snapshot::FormatError("Landmark weights do not match the graph");
+        }
+    }
+}
+
+template <typename Weight>
+void AStarRouter<Weight>::Save(snapshot::Writer& writer) const {
+    writer.WriteVector(landmarks_);
+    for (size_t i = 0; i < landmarks_.size(); ++i) {
+        writer.WriteVector(weights_from_landmarks_[i]);
+        writer.WriteVector(weights_to_landmarks_[i]);
+    }
+}
+
+template <typename Weight>
+typename AStarRouter<Weight>::RepairStats AStarRouter<Weight>::RepairAfterWeightChanges(
+    const std::vector<EdgeWeightChange>& changes) {
+    for (const auto& change : changes) {
+        if (graph_.GetEdge(change.edge).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    if (changes.empty() || landmarks_.empty()) {
+        return {};
+    }
+
+    RepairStats stats;
+    const Graph reversed_graph = graph_.MakeReversed();
+    for (size_t i = 0; i < landmarks_.size(); ++i) {
+        weights_from_landmarks_[i] = ComputeWeights(graph_, landmarks_[i]);
+        weights_to_landmarks_[i] = ComputeWeights(reversed_graph, landmarks_[i]);
+        // Полные поиски обрабатывают все достижимые вершины
+        for (const auto* weights : {&weights_from_landmarks_[i], &weights_to_landmarks_[i]}) {
+            stats.settled_count += static_cast<size_t>(
+                std::count_if(weights->begin(), weights->end(), [](Weight weight) { return weight != INFINITE_WEIGHT; }));
+        }
+    }
+    stats.repaired_count = landmarks_.size();
+    return stats;
+}
+
+// Дейкстра от source по всему графу graph; на обращённом графе — веса путей до source
+template <typename Weight>
+std::vector<Weight> AStarRouter<Weight>::ComputeWeights(const Graph& graph, VertexId source) const {
+    std::vector<Weight> weights(graph.GetVertexCount(), INFINITE_WEIGHT);
+    Queue queue;
+    weights[source] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, source});
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weights[vertex] < weight) {
+            continue;
+        }
+        for (size_t arc = graph.GetArcBegin(vertex); arc < graph.GetArcEnd(vertex); ++arc) {
+            const VertexId target = graph.GetArcTarget(arc);
+            const Weight candidate_weight = weight + graph.GetArcWeight(arc);
+            if (candidate_weight < weights[target]) {
+                weights[target] = candidate_weight;
+                queue.push({candidate_weight, target});
+            }
+        }
+    }
+    return weights;
+}
+
+template <typename Weight>
+void AStarRouter<Weight>::SelectLandmarks(size_t landmark_count) {
+    if (landmark_count == 0) {
+        return;
+    }
+    const size_t vertex_count = graph_.GetVertexCount();
+    const Graph reversed_graph = graph_.MakeReversed();
+
+    // Минимальное расстояние от уже выбранных ориентиров до каждой вершины
+    std::vector<Weight> nearest_landmark_weights(vertex_count, INFINITE_WEIGHT);
+    VertexId candidate = 0;
+    {
+        const auto weights = ComputeWeights(graph_, 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (weights[vertex] != INFINITE_WEIGHT && weights[candidate] < weights[vertex]) {
+                candidate = vertex;
+            }
+        }
+    }
+
+    while (landmarks_.size() < landmark_count) {
+        landmarks_.push_back(candidate);
+        weights_from_landmarks_.push_back(ComputeWeights(graph_, candidate));
+        weights_to_landmarks_.push_back(ComputeWeights(reversed_graph, candidate));
+
+        const auto& weights = weights_from_landmarks_.back();
+        std::optional<VertexId> farthest;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            nearest_landmark_weights[vertex] = std::min(nearest_landmark_weights[vertex], weights[vertex]);
+            if (nearest_landmark_weights[vertex] == INFINITE_WEIGHT || nearest_landmark_weights[vertex] == ZERO_WEIGHT) {
+                continue;
+            }
+            if (!farthest || nearest_landmark_weights[*farthest] < nearest_landmark_weights[vertex]) {
+                farthest = vertex;
+            }
+        }
+        if (!farthest) {
+            break;
+        }
+        candidate = *farthest;
+    }
+}
+
+template <typename Weight>
+Weight AStarRouter<Weight>::EstimateWeight(VertexId vertex, VertexId target) const {
+    Weight estimate = heuristic_ ? heuristic_(vertex, target) : ZERO_WEIGHT;
+
+    for (size_t i = 0; i < landmarks_.size(); ++i) {
+        const auto& from_landmark = weights_from_landmarks_[i];
+        if (from_landmark[vertex] != INFINITE_WEIGHT && from_landmark[target] != INFINITE_WEIGHT
+            && from_landmark[vertex] < from_landmark[target]) {
+            estimate = std::max(estimate, from_landmark[target] - from_landmark[vertex]);
+        }
+        const auto& to_landmark = weights_to_landmarks_[i];
+        if (to_landmark[vertex] != INFINITE_WEIGHT && to_landmark[target] != INFINITE_WEIGHT
+            && to_landmark[target] < to_landmark[vertex]) {
+            estimate = std::max(estimate, to_landmark[vertex] - to_landmark[target]);
+        }
+    }
+    return estimate;
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    thread_local QueryWorkspace workspace;
+    workspace.Prepare(vertex_count);
+
+    Queue queue;
+    workspace.weights[from] = ZERO_WEIGHT;
+    workspace.touched.push_back(from);
+    queue.push({EstimateWeight(from, to), from});
+
+    size_t settled_count = 0;
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().vertex;
+        queue.pop();
+        if (workspace.settled[vertex]) {
+            continue;
+        }
+        workspace.settled[vertex] = true;
+        ++settled_count;
+        if (vertex == to) {
+            break;
+        }
+        const Weight weight = workspace.weights[vertex];
+        for (size_t arc = graph_.GetArcBegin(vertex); arc < graph_.GetArcEnd(vertex); ++arc) {
+            const VertexId target = graph_.GetArcTarget(arc);
+            const Weight candidate_weight = weight + graph_.GetArcWeight(arc);
+            if (candidate_weight < workspace.weights[target]) {
+                if (workspace.weights[target] == INFINITE_WEIGHT) {
+                    workspace.touched.push_back(target);
+                }
+                workspace.weights[target] = candidate_weight;
+                workspace.prev_edges[target] = graph_.GetArcEdgeId(arc);
+                queue.push({candidate_weight + EstimateWeight(target, to), target});
+            }
+        }
+    }
+
+    ++query_count_;
+    settled_count_ += settled_count;
+
+    std::optional<RouteInfo> result;
+    if (workspace.weights[to] != INFINITE_WEIGHT) {
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = workspace.prev_edges[to]; edge_id != NO_EDGE;
+             edge_id = workspace.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        result = RouteInfo{workspace.weights[to], std::move(edges)};
+    }
+
+    workspace.Reset();
+    return result;
+}
+
+template <typename Weight>
+typename AStarRouter<Weight>::SearchStats AStarRouter<Weight>::GetSearchStats() const {
+    SearchStats stats;
+    stats.query_count = query_count_.load();
+    stats.settled_count = settled_count_.load();
+    return stats;
+}
+
+}  // namespace graph
@@ -0,0 +1,695 @@
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "router_engine.h"
+#include "snapshot.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Иерархия сжатий (contraction hierarchies). При построении вершины по очереди
+// «сжимаются» в порядке возрастания важности, а кратчайшие пути через сжатую
+// вершину сохраняются рёбрами-сокращениями (shortcuts). Запрос — двунаправленный
+// Дейкстра только по рёбрам, ведущим к более важным вершинам.
+// Сокращение ссылается на два ребра, из которых оно составлено, поэтому найденный
+// маршрут раскрывается обратно в исходные EdgeId графа.
+template <typename Weight>
+class ContractionHierarchy : public RouterEngine<Weight> {
+private:
+    using Graph = CsrGraph<Weight>;
+
+public:
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+    using EdgeWeightChange = typename RouterEngine<Weight>::EdgeWeightChange;
+    using RepairStats = typename RouterEngine<Weight>::RepairStats;
+
+    explicit ContractionHierarchy(const Graph& graph);
+
+    // Готовая иерархия из снимка: ранги, сокращения и графы вверх без повторного сжатия
+    ContractionHierarchy(const Graph& graph, snapshot::Reader& reader);
+
+    void Save(snapshot::Writer& writer) const;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Many-to-many по корзинам (buckets): обратный поиск вверх из каждой цели
+    // записывает в корзины достигнутых вершин пары (цель, вес), затем прямой поиск
+    // вверх из каждого источника просматривает корзины settled-вершин
+    std::vector<std::vector<std::optional<Weight>>> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                                      const std::vector<VertexId>& targets) const override;
+
+    size_t GetShortcutCount() const {
+        return shortcuts_.size();
+    }
+
+    // Повторное сжатие в прежнем порядке вершин: сокращения и их веса зависят от
+    // весов, а порядок — нет, поэтому пропускается самая дорогая часть построения,
+    // подбор порядка с пересчётом приоритетов. Сокращений, верных при любых весах,
+    // эта иерархия не хранит, так что починить только затронутые нельзя
+    RepairStats RepairAfterWeightChanges(const std::vector<EdgeWeightChange>& changes) override;
+
+private:
+    // Ребро иерархии: исходное (edge < GetEdgeCount()) или сокращение
+    struct Arc {
+        VertexId to;
+        Weight weight;
+        EdgeId edge;
+    };
+
+    struct Shortcut {
+        EdgeId first;
+        EdgeId second;
+    };
+
+    // Рёбра, ведущие к более важным вершинам, в виде CSR
+    struct UpwardGraph {
+        std::vector<size_t> offsets;
+        std::vector<Arc> arcs;
+    };
+
+    template <typename Item>
+    using MinQueue = std::priority_queue<Item, std::vector<Item>, std::greater<Item>>;
+    using QueueItem = std::pair<Weight, VertexId>;
+
+    // Состояние, нужное только на время построения. Списки рёбер содержат
+    // только ещё не сжатые вершины: при сжатии вершина удаляется из списков соседей,
+    // а её оставшиеся рёбра становятся рёбрами «вверх» в upward_arcs.
+    struct ContractionState {
+        std::vector<std::vector<Arc>> out_arcs;
+        // Входящие рёбра: поле to хранит начало ребра
+        std::vector<std::vector<Arc>> in_arcs;
+        std::vector<bool> contracted;
+        std::vector<int> contracted_neighbors;
+        std::vector<std::vector<Arc>> upward_arcs[2];
+
+        // Данные поиска свидетелей, переиспользуются между поисками
+        std::vector<Weight> witness_weights;
+        std::vector<VertexId> witness_touched;
+        std::vector<bool> witness_targets;
+    };
+
+    struct ShortcutCandidate {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first;
+        EdgeId second;
+    };
+
+    // Состояние двунаправленного поиска: индекс 0 — прямой, 1 — обратный
+    struct QueryWorkspace {
+        std::vector<Weight> weights[2];
+        std::vector<VertexId> parent_vertices[2];
+        std::vector<EdgeId> parent_edges[2];
+        std::vector<VertexId> touched[2];
+
+        void Prepare(size_t vertex_count) {
+            for (size_t side = 0; side < 2; ++side) {
+                if (weights[side].size() < vertex_count) {
+                    weights[side].resize(vertex_count, INFINITE_WEIGHT);
+                    parent_vertices[side].resize(vertex_count);
+                    parent_edges[side].resize(vertex_count, NO_EDGE);
+                }
+            }
+        }
+
+        void Reach(size_t side, VertexId vertex, Weight weight, VertexId parent_vertex, EdgeId parent_edge) {
+            if (weights[side][vertex] == INFINITE_WEIGHT) {
+                touched[side].push_back(vertex);
+            }
+            weights[side][vertex] = weight;
+            parent_vertices[side][vertex] = parent_vertex;
+            parent_edges[side][vertex] = parent_edge;
+        }
+
+        void Reset() {
+            for (size_t side = 0; side < 2; ++side) {
+                for (const VertexId vertex : touched[side]) {
+                    weights[side][vertex] = INFINITE_WEIGHT;
+                    parent_edges[side][vertex] = NO_EDGE;
+                }
+                touched[side].clear();
+            }
+        }
+    };
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+    // Ограничения поиска свидетелей: если свидетель не найден, сокращение
+    // добавляется, что лишь увеличивает их число, но не ломает корректность.
+    // Для оценки приоритета достаточно более грубого поиска.
+    static constexpr size_t PRIORITY_SETTLED_LIMIT = 50;
+    static constexpr size_t CONTRACTION_SETTLED_LIMIT = 1000;
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    const Graph& graph_;
+    std::vector<size_t> ranks_;
+    std::vector<Shortcut> shortcuts_;
+    UpwardGraph forward_graph_;
+    UpwardGraph backward_graph_;
+
+    void InitializeState(ContractionState& state) const;
+    static void AddArc(ContractionState& state, VertexId from, const Arc& arc);
+    static void RunWitnessSearch(ContractionState& state, VertexId source, VertexId skipped,
+                                 Weight max_weight, size_t target_count, size_t settled_limit);
+    static std::vector<ShortcutCandidate> FindShortcuts(ContractionState& state, VertexId vertex, size_t settled_limit);
+    static int ComputePriority(ContractionState& state, VertexId vertex);
+    void Contract(ContractionState& state, VertexId vertex);
+    void BuildUpwardGraphs(ContractionState& state);
+    UpwardGraph LoadUpwardGraph(snapshot::Reader& reader) const;
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+    // Полный поиск вверх из source по направлению side со stall-on-demand;
+    // on_settled вызывается для каждой нерастянутой обработанной вершины
+    template <typename OnSettled>
+    void RunUpwardSearch(QueryWorkspace& workspace, size_t side, VertexId source, OnSettled on_settled) const;
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : graph_(graph)
+    , ranks_(graph.GetVertexCount())
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    ContractionState state;
+    InitializeState(state);
+
+    MinQueue<std::pair<int, VertexId>> queue;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        queue.push({ComputePriority(state, vertex), vertex});
+    }
+
+    // Ленивое обновление приоритетов: перед сжатием приоритет пересчитывается,
+    // и если вершина перестала быть минимальной, она возвращается в очередь
+    size_t rank = 0;
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+        if (state.contracted[vertex]) {
+            continue;
+        }
+        const int priority = ComputePriority(state, vertex);
+        if (!queue.empty() && priority > queue.top().first) {
+            queue.push({priority, vertex});
+            continue;
+        }
+        ranks_[vertex] = rank++;
+        Contract(state, vertex);
+    }
+
+    BuildUpwardGraphs(state);
+}
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, snapshot::Reader& reader)
+    : graph_(graph)
+    , ranks_(reader.ReadVector<size_t>())
+    , shortcuts_(reader.ReadVector<Shortcut>())
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    if (ranks_.size() != vertex_count) {
+        throw snapshot::FormatError("Contraction hierarchy does not match its graph");
+    }
+    for (const size_t rank : ranks_) {
+        if (rank >= vertex_count) {
+            throw snapshot::FormatError("Vertex rank is out of range in snapshot");
+        }
+    }
+    // Сокращение составлено из рёбер, существовавших до него: так раскрытие
+    // маршрута не зациклится
+    const EdgeId edge_count = graph.GetEdgeCount();
+    for (size_t i = 0; i < shortcuts_.size(); ++i) {
+        if (shortcuts_[i].first >= edge_count + i || shortcuts_[i].second >= edge_count + i) {
+            throw snapshot::FormatError("Shortcut edge is out of range in snapshot");
+        }
+    }
+    forward_graph_ = LoadUpwardGraph(reader);
+    backward_graph_ = LoadUpwardGraph(reader);
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::Save(snapshot::Writer& writer) const {
+    writer.WriteVector(ranks_);
+    writer.WriteVector(shortcuts_);
+    for (const UpwardGraph* upward_graph : {&forward_graph_, &backward_graph_}) {
+        writer.WriteVector(upward_graph->offsets);
+        writer.WriteVector(upward_graph->arcs);
+    }
+}
+
+template <typename Weight>
+typename ContractionHierarchy<Weight>::UpwardGraph ContractionHierarchy<Weight>::LoadUpwardGraph(
+    snapshot::Reader& reader) const {
+    UpwardGraph upward_graph;
+    upward_graph.offsets = reader.ReadVector<size_t>();
+    upward_graph.arcs = reader.ReadVector<Arc>();
+
+    const size_t vertex_count = graph_.GetVertexCount();
+    const auto& offsets = upward_graph.offsets;
+    if (offsets.size() != vertex_count + 1 || offsets.front() != 0 || offsets.back() != upward_graph.arcs.size()
+        || !std::is_sorted(offsets.begin(), offsets.end())) {
+        throw snapshot::FormatError("Inconsistent contraction hierarchy in snapshot");
+    }
+    const size_t arc_edge_count = graph_.GetEdgeCount() + shortcuts_.size();
+    for (const Arc& arc : upward_graph.arcs) {
+        if (arc.to >= vertex_count || arc.edge >= arc_edge_count) {
+            throw snapshot::FormatError("Inconsistent contraction hierarchy in snapshot");
+        }
+    }
+    return upward_graph;
+}
+
+template <typename Weight>
+typename ContractionHierarchy<Weight>::RepairStats ContractionHierarchy<Weight>::RepairAfterWeightChanges(
+    const std::vector<EdgeWeightChange>& changes) {
+    if (changes.empty()) {
+        return {};
+    }
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<VertexId> order(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order[ranks_[vertex]] = vertex;
+    }
+
+    shortcuts_.clear();
+    ContractionState state;
+    InitializeState(state);
+    for (const VertexId vertex : order) {
+        Contract(state, vertex);
+    }
+    BuildUpwardGraphs(state);
+
+    RepairStats stats;
+    stats.repaired_count = vertex_count;
+    return stats;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::InitializeState(ContractionState& state) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    state.out_arcs.resize(vertex_count);
+    state.in_arcs.resize(vertex_count);
+    state.contracted.assign(vertex_count, false);
+    state.contracted_neighbors.assign(vertex_count, 0);
+    state.upward_arcs[0].resize(vertex_count);
+    state.upward_arcs[1].resize(vertex_count);
+    state.witness_weights.assign(vertex_count, INFINITE_WEIGHT);
+    state.witness_targets.assign(vertex_count, false);
+
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (size_t arc = graph_.GetArcBegin(vertex); arc < graph_.GetArcEnd(vertex); ++arc) {
+            const VertexId target = graph_.GetArcTarget(arc);
+            const Weight weight = graph_.GetArcWeight(arc);
+            if (weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (vertex != target) {
+                AddArc(state, vertex, {target, weight, graph_.GetArcEdgeId(arc)});
+            }
+        }
+    }
+}
+
+// Из параллельных рёбер хранится только самое лёгкое
+template <typename Weight>
+void ContractionHierarchy<Weight>::AddArc(ContractionState& state, VertexId from, const Arc& arc) {
+    auto& out_arcs = state.out_arcs[from];
+    auto it = std::find_if(out_arcs.begin(), out_arcs.end(), [&arc](const Arc& other) {
+        return other.to == arc.to;
+    });
+    if (it == out_arcs.end()) {
+        out_arcs.push_back(arc);
+        state.in_arcs[arc.to].push_back({from, arc.weight, arc.edge});
+        return;
+    }
+    if (!(arc.weight < it->weight)) {
+        return;
+    }
+    *it = arc;
+    for (auto& in_arc : state.in_arcs[arc.to]) {
+        if (in_arc.to == from) {
+            in_arc.weight = arc.weight;
+            in_arc.edge = arc.edge;
+            break;
+        }
+    }
+}
+
+// Дейкстра от source в обход skipped. Останавливается, когда найдены все
+// target_count вершин-целей, превышен max_weight или исчерпан лимит. Расстояния
+// остаются в state.witness_weights, вызывающий сбрасывает их по witness_touched.
+template <typename Weight>
+void ContractionHierarchy<Weight>::RunWitnessSearch(ContractionState& state, VertexId source, VertexId skipped,
+                                                    Weight max_weight, size_t target_count, size_t settled_limit) {
+    MinQueue<QueueItem> queue;
+    state.witness_weights[source] = ZERO_WEIGHT;
+    state.witness_touched.push_back(source);
+    queue.push({ZERO_WEIGHT, source});
+
+    size_t settled_count = 0;
+    while (!queue.empty() && settled_count < settled_limit && target_count > 0) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (state.witness_weights[vertex] < weight) {
+            continue;
+        }
+        ++settled_count;
+        if (state.witness_targets[vertex]) {
+            --target_count;
+        }
+        for (const Arc& arc : state.out_arcs[vertex]) {
+            if (arc.to == skipped) {
+                continue;
+            }
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < state.witness_weights[arc.to] && !(max_weight < candidate_weight)) {
+                if (state.witness_weights[arc.to] == INFINITE_WEIGHT) {
+                    state.witness_touched.push_back(arc.to);
+                }
+                state.witness_weights[arc.to] = candidate_weight;
+                queue.push({candidate_weight, arc.to});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+std::vector<typename ContractionHierarchy<Weight>::ShortcutCandidate>
+ContractionHierarchy<Weight>::FindShortcuts(ContractionState& state, VertexId vertex, size_t settled_limit) {
+    std::vector<ShortcutCandidate> result;
+
+    // Свидетель возможен только для вершин, в которые ведёт ещё хотя бы одно ребро
+    Weight max_out_weight = ZERO_WEIGHT;
+    size_t target_count = 0;
+    for (const Arc& out_arc : state.out_arcs[vertex]) {
+        if (state.in_arcs[out_arc.to].size() > 1) {
+            max_out_weight = std::max(max_out_weight, out_arc.weight);
+            state.witness_targets[out_arc.to] = true;
+            ++target_count;
+        }
+    }
+
+    for (const Arc& in_arc : state.in_arcs[vertex]) {
+        const VertexId from = in_arc.to;
+        const size_t from_target_count = target_count - (state.witness_targets[from] ? 1 : 0);
+        if (from_target_count > 0) {
+            RunWitnessSearch(state, from, vertex, in_arc.weight + max_out_weight, from_target_count, settled_limit);
+        }
+
+        for (const Arc& out_arc : state.out_arcs[vertex]) {
+            if (out_arc.to == from) {
+                continue;
+            }
+            const Weight shortcut_weight = in_arc.weight + out_arc.weight;
+            if (shortcut_weight < state.witness_weights[out_arc.to]) {
+                result.push_back({from, out_arc.to, shortcut_weight, in_arc.edge, out_arc.edge});
+            }
+        }
+
+        for (const VertexId touched : state.witness_touched) {
+            state.witness_weights[touched] = INFINITE_WEIGHT;
+        }
+        state.witness_touched.clear();
+    }
+
+    for (const Arc& out_arc : state.out_arcs[vertex]) {
+        state.witness_targets[out_arc.to] = false;
+    }
+    return result;
+}
+
+// Приоритет — удвоенная разность рёбер (добавляемые сокращения минус удаляемые рёбра)
+// плюс число уже сжатых соседей, чтобы сжатия распределялись по графу равномерно
+template <typename Weight>
+int ContractionHierarchy<Weight>::ComputePriority(ContractionState& state, VertexId vertex) {
+    const int removed_arcs = static_cast<int>(state.out_arcs[vertex].size() + state.in_arcs[vertex].size());
+    const int shortcut_count = static_cast<int>(FindShortcuts(state, vertex, PRIORITY_SETTLED_LIMIT).size());
+    return 2 * (shortcut_count - removed_arcs) + state.contracted_neighbors[vertex];
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::Contract(ContractionState& state, VertexId vertex) {
+    const auto shortcuts = FindShortcuts(state, vertex, CONTRACTION_SETTLED_LIMIT);
+
+    auto remove_vertex = [vertex](std::vector<Arc>& arcs) {
+        arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [vertex](const Arc& arc) {
+            return arc.to == vertex;
+        }), arcs.end());
+    };
+    for (const Arc& arc : state.out_arcs[vertex]) {
+        remove_vertex(state.in_arcs[arc.to]);
+        ++state.contracted_neighbors[arc.to];
+    }
+    for (const Arc& arc : state.in_arcs[vertex]) {
+        remove_vertex(state.out_arcs[arc.to]);
+        ++state.contracted_neighbors[arc.to];
+    }
+    state.upward_arcs[0][vertex] = std::move(state.out_arcs[vertex]);
+    state.upward_arcs[1][vertex] = std::move(state.in_arcs[vertex]);
+    state.out_arcs[vertex].clear();
+    state.in_arcs[vertex].clear();
+    state.contracted[vertex] = true;
+
+    const EdgeId edge_count = graph_.GetEdgeCount();
+    for (const auto& candidate : shortcuts) {
+        const EdgeId shortcut_id = edge_count + shortcuts_.size();
+        shortcuts_.push_back({candidate.first, candidate.second});
+        AddArc(state, candidate.from, {candidate.to, candidate.weight, shortcut_id});
+    }
+}
+
+// Оставшиеся при сжатии рёбра ведут к более важным вершинам: исходящие образуют
+// прямой граф, входящие (в обратном направлении) — обратный
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildUpwardGraphs(ContractionState& state) {
+    const size_t vertex_count = graph_.GetVertexCount();
+
+    auto to_csr = [vertex_count](std::vector<std::vector<Arc>>& arcs, UpwardGraph& upward_graph) {
+        upward_graph.offsets.assign(vertex_count + 1, 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            upward_graph.offsets[vertex + 1] = upward_graph.offsets[vertex] + arcs[vertex].size();
+        }
+        upward_graph.arcs.clear();
+        upward_graph.arcs.reserve(upward_graph.offsets.back());
+        for (auto& vertex_arcs : arcs) {
+            upward_graph.arcs.insert(upward_graph.arcs.end(), vertex_arcs.begin(), vertex_arcs.end());
+            vertex_arcs = {};
+        }
+    };
+    to_csr(state.upward_arcs[0], forward_graph_);
+    to_csr(state.upward_arcs[1], backward_graph_);
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+    const EdgeId edge_count = graph_.GetEdgeCount();
+    std::vector<EdgeId> stack{edge_id};
+    while (!stack.empty()) {
+        const EdgeId current = stack.back();
+        stack.pop_back();
+        if (current < edge_count) {
+            edges.push_back(current);
+        } else {
+            const Shortcut& shortcut = shortcuts_[current - edge_count];
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(
+    VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    // Рабочие массивы поиска живут в потоке и сбрасываются по списку посещённых
+    // вершин, так что запрос не тратит O(V) на их заполнение
+    thread_local QueryWorkspace workspace;
+    workspace.Prepare(vertex_count);
+
+    // Индекс 0 — прямой поиск от from, индекс 1 — обратный от to
+    const UpwardGraph* upward_graphs[2] = {&forward_graph_, &backward_graph_};
+    MinQueue<QueueItem> queues[2];
+    workspace.Reach(0, from, ZERO_WEIGHT, from, NO_EDGE);
+    workspace.Reach(1, to, ZERO_WEIGHT, to, NO_EDGE);
+    queues[0].push({ZERO_WEIGHT, from});
+    queues[1].push({ZERO_WEIGHT, to});
+
+    Weight best_weight = INFINITE_WEIGHT;
+    std::optional<VertexId> meeting_vertex;
+
+    while (true) {
+        // Направление перестаёт искать, когда его минимум не лучше найденного пути
+        for (auto& queue : queues) {
+            if (!queue.empty() && !(queue.top().first < best_weight)) {
+                queue = {};
+            }
+        }
+        if (queues[0].empty() && queues[1].empty()) {
+            break;
+        }
+        const size_t side = queues[1].empty() || (!queues[0].empty() && queues[0].top().first <= queues[1].top().first)
+                          ? 0 : 1;
+        const auto [weight, vertex] = queues[side].top();
+        queues[side].pop();
+        auto& weights = workspace.weights[side];
+        if (weights[vertex] < weight) {
+            continue;
+        }
+
+        const Weight other_weight = workspace.weights[1 - side][vertex];
+        if (other_weight != INFINITE_WEIGHT && weight + other_weight < best_weight) {
+            best_weight = weight + other_weight;
+            meeting_vertex = vertex;
+        }
+
+        // Stall-on-demand: если в вершину короче прийти сверху, её рёбра можно
+        // не релаксировать — через неё не проходит кратчайший путь этого поиска
+        const UpwardGraph& downward_graph = *upward_graphs[1 - side];
+        bool stalled = false;
+        for (size_t i = downward_graph.offsets[vertex]; i < downward_graph.offsets[vertex + 1]; ++i) {
+            const Arc& arc = downward_graph.arcs[i];
+            if (weights[arc.to] != INFINITE_WEIGHT && weights[arc.to] + arc.weight < weight) {
+                stalled = true;
+                break;
+            }
+        }
+        if (stalled) {
+            continue;
+        }
+
+        const UpwardGraph& upward_graph = *upward_graphs[side];
+        for (size_t i = upward_graph.offsets[vertex]; i < upward_graph.offsets[vertex + 1]; ++i) {
+            const Arc& arc = upward_graph.arcs[i];
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < weights[arc.to]) {
+                workspace.Reach(side, arc.to, candidate_weight, vertex, arc.edge);
+                queues[side].push({candidate_weight, arc.to});
+            }
+        }
+    }
+
+    std::optional<RouteInfo> result;
+    if (meeting_vertex) {
+        std::vector<EdgeId> forward_edges;
+        for (VertexId vertex = *meeting_vertex; workspace.parent_edges[0][vertex] != NO_EDGE;
+             vertex = workspace.parent_vertices[0][vertex]) {
+            forward_edges.push_back(workspace.parent_edges[0][vertex]);
+        }
+        std::vector<EdgeId> edges;
+        for (auto it = forward_edges.rbegin(); it != forward_edges.rend(); ++it) {
+            UnpackEdge(*it, edges);
+        }
+        for (VertexId vertex = *meeting_vertex; workspace.parent_edges[1][vertex] != NO_EDGE;
+             vertex = workspace.parent_vertices[1][vertex]) {
+            UnpackEdge(workspace.parent_edges[1][vertex], edges);
+        }
+        result = RouteInfo{best_weight, std::move(edges)};
+    }
+
+    workspace.Reset();
+    return result;
+}
+
+template <typename Weight>
+template <typename OnSettled>
+void ContractionHierarchy<Weight>::RunUpwardSearch(QueryWorkspace& workspace, size_t side, VertexId source,
+                                                   OnSettled on_settled) const {
+    const UpwardGraph& upward_graph = side == 0 ? forward_graph_ : backward_graph_;
+    const UpwardGraph& downward_graph = side == 0 ? backward_graph_ : forward_graph_;
+    auto& weights = workspace.weights[side];
+
+    MinQueue<QueueItem> queue;
+    workspace.Reach(side, source, ZERO_WEIGHT, source, NO_EDGE);
+    queue.push({ZERO_WEIGHT, source});
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weights[vertex] < weight) {
+            continue;
+        }
+
+        bool stalled = false;
+        for (size_t i = downward_graph.offsets[vertex]; i < downward_graph.offsets[vertex + 1]; ++i) {
+            const Arc& arc = downward_graph.arcs[i];
+            if (weights[arc.to] != INFINITE_WEIGHT && weights[arc.to] + arc.weight < weight) {
+                stalled = true;
+                break;
+            }
+        }
+        if (stalled) {
+            continue;
+        }
+        on_settled(vertex, weight);
+
+        for (size_t i = upward_graph.offsets[vertex]; i < upward_graph.offsets[vertex + 1]; ++i) {
+            const Arc& arc = upward_graph.arcs[i];
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < weights[arc.to]) {
+                workspace.Reach(side, arc.to, candidate_weight, vertex, arc.edge);
+                queue.push({candidate_weight, arc.to});
+            }
+        }
+    }
+    workspace.Reset();
+}
+
+template <typename Weight>
+std::vector<std::vector<std::optional<Weight>>> ContractionHierarchy<Weight>::BuildWeightMatrix(
+    const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    for (const auto* vertexes : {&sources, &targets}) {
+        for (const VertexId vertex : *vertexes) {
+            if (vertex >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+        }
+    }
+
+    thread_local QueryWorkspace workspace;
+    workspace.Prepare(vertex_count);
+
+    struct BucketEntry {
+        size_t target_index;
+        Weight weight;
+    };
+    std::vector<std::vector<BucketEntry>> buckets(vertex_count);
+    for (size_t target_index = 0; target_index < targets.size(); ++target_index) {
+        RunUpwardSearch(workspace, 1, targets[target_index], [&](VertexId vertex, Weight weight) {
+            buckets[vertex].push_back({target_index, weight});
+        });
+    }
+
+    std::vector<std::vector<std::optional<Weight>>> matrix;
+    matrix.reserve(sources.size());
+    std::vector<Weight> row_weights(targets.size());
+    for (const VertexId from : sources) {
+        std::fill(row_weights.begin(), row_weights.end(), INFINITE_WEIGHT);
+        RunUpwardSearch(workspace, 0, from, [&](VertexId vertex, Weight weight) {
+            for (const auto& [target_index, target_weight] : buckets[vertex]) {
+                row_weights[target_index] = std::min(row_weights[target_index], weight + target_weight);
+            }
+        });
+
+        auto& row = matrix.emplace_back();
+        row.reserve(targets.size());
+        for (const Weight weight : row_weights) {
+            row.push_back(weight == INFINITE_WEIGHT ? std::nullopt : std::optional<Weight>(weight));
+        }
+    }
+    return matrix;
+}
+
+}  // namespace graph
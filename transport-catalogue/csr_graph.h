@@ -0,0 +1,181 @@
+#pragma once
+
+#include "graph.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+// Замороженный граф в формате CSR (compressed sparse row). Дуги вершины v
+// занимают индексы [GetArcBegin(v), GetArcEnd(v)), а их концы, веса и исходные
+// идентификаторы рёбер лежат в параллельных массивах, поэтому релаксация дуги
+// читает подряд идущую память без обращения к рёбрам по идентификатору.
+// Идентификаторы рёбер (EdgeId) совпадают с идентификаторами исходного графа.
+template <typename Weight>
+class CsrGraph {
+public:
+    CsrGraph() = default;
+    explicit CsrGraph(const DirectedWeightedGraph<Weight>& graph);
+
+    void Save(snapshot::Writer& writer) const;
+    static CsrGraph Load(snapshot::Reader& reader);
+
+    // Граф с обращёнными дугами: дуги вершины v — рёбра, входящие в v,
+    // GetArcTarget возвращает их начало. GetEdge у обращённого графа недоступен.
+    CsrGraph MakeReversed() const;
+
+    size_t GetVertexCount() const {
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+    size_t GetEdgeCount() const {
+        return targets_.size();
+    }
+
+    size_t GetArcBegin(VertexId vertex) const {
+        return offsets_[vertex];
+    }
+    size_t GetArcEnd(VertexId vertex) const {
+        return offsets_[vertex + 1];
+    }
+    VertexId GetArcTarget(size_t arc) const {
+        return targets_[arc];
+    }
+    Weight GetArcWeight(size_t arc) const {
+        return weights_[arc];
+    }
+    EdgeId GetArcEdgeId(size_t arc) const {
+        return edge_ids_[arc];
+    }
+
+    // Ребро по идентификатору исходного графа, для восстановления маршрутов
+    const Edge<Weight>& GetEdge(EdgeId edge_id) const {
+        return edges_.at(edge_id);
+    }
+
+    // Новый вес ребра без перестроения; структура графа не меняется.
+    // Обращённые копии (MakeReversed) при этом не обновляются
+    void SetEdgeWeight(EdgeId edge_id, Weight weight);
+
+    // Политика размещения для уже заполненных массивов: прозрачные огромные
+    // страницы и перенос страниц на узлы NUMA. Возвращает применённую политику
+    storage::MemoryPolicy ApplyMemoryPolicy(const storage::MemoryPolicy& policy);
+
+private:
+    std::vector<CompactEdgeId> offsets_;
+    std::vector<CompactVertexId> targets_;
+    std::vector<Weight> weights_;
+    std::vector<CompactEdgeId> edge_ids_;
+    std::vector<Edge<Weight>> edges_;
+};
+
+template <typename Weight>
+CsrGraph<Weight>::CsrGraph(const DirectedWeightedGraph<Weight>& graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    const size_t edge_count = graph.GetEdgeCount();
+    if (vertex_count >= std::numeric_limits<CompactVertexId>::max()
+        || edge_count >= std::numeric_limits<CompactEdgeId>::max()) {
+        throw std::length_error("Graph is too large for the CSR form");
+    }
+
+    offsets_.reserve(vertex_count + 1);
+    targets_.reserve(edge_count);
+    weights_.reserve(edge_count);
+    edge_ids_.reserve(edge_count);
+    edges_.reserve(edge_count);
+
+    offsets_.push_back(0);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            targets_.push_back(static_cast<CompactVertexId>(edge.to));
+            weights_.push_back(edge.weight);
+            edge_ids_.push_back(static_cast<CompactEdgeId>(edge_id));
+        }
+        offsets_.push_back(static_cast<CompactEdgeId>(targets_.size()));
+    }
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        edges_.push_back(graph.GetEdge(edge_id));
+    }
+}
+
+template <typename Weight>
+void CsrGraph<Weight>::SetEdgeWeight(EdgeId edge_id, Weight weight) {
+    Edge<Weight>& edge = edges_.at(edge_id);
+    edge.weight = weight;
+    for (size_t arc = GetArcBegin(edge.from); arc < GetArcEnd(edge.from); ++arc) {
+        if (edge_ids_[arc] == edge_id) {
+            weights_[arc] = weight;
+            return;
+        }
+    }
+}
+
+template <typename Weight>
+storage::MemoryPolicy CsrGraph<Weight>::ApplyMemoryPolicy(const storage::MemoryPolicy& policy) {
+    // Массивы меньше огромной страницы не получат её, поэтому итог — по самому большому
+    storage::MemoryPolicy applied = storage::ApplyMemoryPolicy(edges_.data(), edges_.size() * sizeof(Edge<Weight>), policy);
+    storage::ApplyMemoryPolicy(offsets_.data(), offsets_.size() * sizeof(CompactEdgeId), policy);
+    storage::ApplyMemoryPolicy(targets_.data(), targets_.size() * sizeof(CompactVertexId), policy);
+    storage::ApplyMemoryPolicy(weights_.data(), weights_.size() * sizeof(Weight), policy);
+    storage::ApplyMemoryPolicy(edge_ids_.data(), edge_ids_.size() * sizeof(CompactEdgeId), policy);
+    return applied;
+}
+
+template <typename Weight>
+void CsrGraph<Weight>::Save(snapshot::Writer& writer) const {
+    writer.WriteVector(offsets_);
+    writer.WriteVector(targets_);
+    writer.WriteVector(weights_);
+    writer.WriteVector(edge_ids_);
+    writer.WriteVector(edges_);
+}
+
+template <typename Weight>
+CsrGraph<Weight> CsrGraph<Weight>::Load(snapshot::Reader& reader) {
+    CsrGraph graph;
+    graph.offsets_ = reader.ReadVector<CompactEdgeId>();
+    graph.targets_ = reader.ReadVector<CompactVertexId>();
+    graph.weights_ = reader.ReadVector<Weight>();
+    graph.edge_ids_ = reader.ReadVector<CompactEdgeId>();
+    graph.edges_ = reader.ReadVector<Edge<Weight>>();
+
+    const size_t edge_count = graph.targets_.size();
+    if (graph.offsets_.empty() || graph.offsets_.back() != edge_count || graph.weights_.size() != edge_count
+        || graph.edge_ids_.size() != edge_count || graph.edges_.size() != edge_count) {
+        throw snapshot::FormatError("Inconsistent CSR graph in snapshot");
+    }
+    return graph;
+}
+
+template <typename Weight>
+CsrGraph<Weight> CsrGraph<Weight>::MakeReversed() const {
+    const size_t vertex_count = GetVertexCount();
+    CsrGraph reversed;
+    reversed.offsets_.assign(vertex_count + 1, 0);
+    for (const CompactVertexId target : targets_) {
+        ++reversed.offsets_[target + 1];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        reversed.offsets_[vertex + 1] += reversed.offsets_[vertex];
+    }
+
+    reversed.targets_.resize(targets_.size());
+    reversed.weights_.resize(weights_.size());
+    reversed.edge_ids_.resize(edge_ids_.size());
+    std::vector<CompactEdgeId> positions(reversed.offsets_.begin(), reversed.offsets_.end() - 1);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (size_t arc = GetArcBegin(vertex); arc < GetArcEnd(vertex); ++arc) {
+            const CompactEdgeId position = positions[targets_[arc]]++;
+            reversed.targets_[position] = static_cast<CompactVertexId>(vertex);
+            reversed.weights_[position] = weights_[arc];
+            reversed.edge_ids_[position] = edge_ids_[arc];
+        }
+    }
+    return reversed;
+}
+
+}  // namespace graph
@@ -0,0 +1,329 @@
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "router_engine.h"
+#include "spt_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Маршрутизатор без предрасчёта: на каждый запрос запускается алгоритм Дейкстры
+// с бинарной кучей. Построение занимает O(V + E), запрос — O((V + E) log V).
+// С ненулевым cache_bytes поиск строит полное дерево кратчайших путей из from
+// и кладёт его в LRU-кэш, так что следующие запросы из той же вершины
+// только восстанавливают путь.
+template <typename Weight>
+class DijkstraRouter : public RouterEngine<Weight> {
+private:
+    using Graph = CsrGraph<Weight>;
+
+public:
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+    using SearchStats = typename RouterEngine<Weight>::SearchStats;
+    using EdgeWeightChange = typename RouterEngine<Weight>::EdgeWeightChange;
+    using RepairStats = typename RouterEngine<Weight>::RepairStats;
+
+    explicit DijkstraRouter(const Graph& graph, size_t cache_bytes = 0);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+    // Один поиск из from, который останавливается, когда обработаны все цели
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const override;
+    SearchStats GetSearchStats() const override;
+    // Предрасчёта нет, кэшированные деревья устарели и сбрасываются
+    RepairStats RepairAfterWeightChanges(const std::vector<EdgeWeightChange>& changes) override;
+
+    // Статистика кэша деревьев, нули без кэша
+    typename ShortestPathTreeCache<Weight>::Stats GetCacheStats() const;
+
+private:
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+    using Tree = ShortestPathTree<Weight>;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr CompactEdgeId NO_EDGE = std::numeric_limits<CompactEdgeId>::max();
+
+    const Graph& graph_;
+    std::unique_ptr<ShortestPathTreeCache<Weight>> cache_;
+
+    mutable std::atomic<size_t> query_count_ = 0;
+    mutable std::atomic<size_t> settled_count_ = 0;
+
+    // Дейкстра из from до обработки всех вершин с is_target (без целей — до конца)
+    std::shared_ptr<const Tree> BuildTree(VertexId from, const std::vector<bool>* is_target = nullptr,
+                                          size_t target_count = 0) const;
+    std::optional<RouteInfo> BuildRouteFromTree(const Tree& tree, VertexId to) const;
+};
+
+// Ограниченный Дейкстра: on_settled(vertex, weight) вызывается для каждой вершины,
+// достижимой из source с весом не больше max_weight, в порядке возрастания веса.
+// Поиск не выходит за пределы этого множества вершин. При отрицательном max_weight
+// не достижима даже source.
+template <typename Weight, typename OnSettled>
+void VisitVertexesWithinWeight(const CsrGraph<Weight>& graph, VertexId source, Weight max_weight, OnSettled on_settled) {
+    if (max_weight < Weight{}) {
+        return;
+    }
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+    std::unordered_map<VertexId, Weight> weights;
+
+    weights[source] = Weight{};
+    queue.push({Weight{}, source});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weights.at(vertex) < weight) {
+            continue;
+        }
+        on_settled(vertex, weight);
+
+        for (size_t arc = graph.GetArcBegin(vertex); arc < graph.GetArcEnd(vertex); ++arc) {
+            const VertexId target = graph.GetArcTarget(arc);
+            const Weight candidate_weight = weight + graph.GetArcWeight(arc);
+            if (max_weight < candidate_weight) {
+                continue;
+            }
+            auto [it, inserted] = weights.emplace(target, candidate_weight);
+            if (inserted || candidate_weight < it->second) {
+                it->second = candidate_weight;
+                queue.push({candidate_weight, target});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, size_t cache_bytes)
+    : graph_(graph)
+{
+    for (size_t arc = 0; arc < graph.GetEdgeCount(); ++arc) {
+        if (graph.GetArcWeight(arc) < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    // Если в бюджет не помещается ни одно дерево, полный поиск только замедлил бы запросы
+    if (cache_bytes >= Tree::GetByteSize(graph.GetVertexCount())) {
+        cache_ = std::make_unique<ShortestPathTreeCache<Weight>>(cache_bytes);
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    if (cache_) {
+        auto tree = cache_->Find(from);
+        if (!tree) {
+            tree = BuildTree(from);
+            cache_->Insert(from, tree);
+        }
+        ++query_count_;
+        return BuildRouteFromTree(*tree, to);
+    }
+
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+    std::vector<bool> settled(vertex_count, false);
+
+    Queue queue;
+    weights[from] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, from});
+
+    size_t settled_count = 0;
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (settled[vertex]) {
+            continue;
+        }
+        settled[vertex] = true;
+        ++settled_count;
+        if (vertex == to) {
+            break;
+        }
+        for (size_t arc = graph_.GetArcBegin(vertex); arc < graph_.GetArcEnd(vertex); ++arc) {
+            const VertexId target = graph_.GetArcTarget(arc);
+            const Weight candidate_weight = weight + graph_.GetArcWeight(arc);
+            if (!weights[target] || candidate_weight < *weights[target]) {
+                weights[target] = candidate_weight;
+                prev_edges[target] = graph_.GetArcEdgeId(arc);
+                queue.push({candidate_weight, target});
+            }
+        }
+    }
+
+    ++query_count_;
+    settled_count_ += settled_count;
+
+    if (!weights[to]) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = prev_edges[to];
+         edge_id;
+         edge_id = prev_edges[graph_.GetEdge(*edge_id).from])
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{*weights[to], std::move(edges)};
+}
+
+// Без целей поиск идёт до конца: дерево в кэше должно годиться для любой цели
+template <typename Weight>
+std::shared_ptr<const typename DijkstraRouter<Weight>::Tree> DijkstraRouter<Weight>::BuildTree(
+    VertexId from, const std::vector<bool>* is_target, size_t target_count) const {
+    auto tree = std::make_shared<Tree>();
+    tree->weights.assign(graph_.GetVertexCount(), INFINITE_WEIGHT);
+    tree->prev_edges.assign(graph_.GetVertexCount(), NO_EDGE);
+
+    Queue queue;
+    tree->weights[from] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, from});
+
+    size_t settled_count = 0;
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (tree->weights[vertex] < weight) {
+            continue;
+        }
+        ++settled_count;
+        if (is_target && (*is_target)[vertex] && --target_count == 0) {
+            break;
+        }
+        for (size_t arc = graph_.GetArcBegin(vertex); arc < graph_.GetArcEnd(vertex); ++arc) {
+            const VertexId target = graph_.GetArcTarget(arc);
+            const Weight candidate_weight = weight + graph_.GetArcWeight(arc);
+            if (candidate_weight < tree->weights[target]) {
+                tree->weights[target] = candidate_weight;
+                tree->prev_edges[target] = static_cast<CompactEdgeId>(graph_.GetArcEdgeId(arc));
+                queue.push({candidate_weight, target});
+            }
+        }
+    }
+    settled_count_ += settled_count;
+    return tree;
+}
+
+template <typename Weight>
+std::vector<std::optional<typename DijkstraRouter<Weight>::RouteInfo>> DijkstraRouter<Weight>::BuildRoutes(
+    VertexId from, const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    if (targets.empty()) {
+        return {};
+    }
+    for (const VertexId to : targets) {
+        if (to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+
+    std::shared_ptr<const Tree> tree;
+    if (cache_) {
+        tree = cache_->Find(from);
+        if (!tree) {
+            tree = BuildTree(from);
+            cache_->Insert(from, tree);
+        }
+    } else {
+        std::vector<bool> is_target(vertex_count, false);
+        size_t target_count = 0;
+        for (const VertexId to : targets) {
+            if (!is_target[to]) {
+                is_target[to] = true;
+                ++target_count;
+            }
+        }
+        tree = BuildTree(from, &is_target, target_count);
+    }
+    query_count_ += targets.size();
+
+    std::vector<std::optional<RouteInfo>> routes;
+    routes.reserve(targets.size());
+    for (const VertexId to : targets) {
+        routes.push_back(BuildRouteFromTree(*tree, to));
+    }
+    return routes;
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRouteFromTree(const Tree& tree,
+                                                                                                      VertexId to) const {
+    if (tree.weights[to] == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (CompactEdgeId edge_id = tree.prev_edges[to]; edge_id != NO_EDGE;
+         edge_id = tree.prev_edges[graph_.GetEdge(edge_id).from]) {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{tree.weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::SearchStats DijkstraRouter<Weight>::GetSearchStats() const {
+    SearchStats stats;
+    stats.query_count = query_count_.load();
+    stats.settled_count = settled_count_.load();
+    if (cache_) {
+        const auto cache_stats = cache_->GetStats();
+        stats.cache_hit_count = cache_stats.hit_count;
+        stats.cache_miss_count = cache_stats.miss_count;
+    }
+    return stats;
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::RepairStats DijkstraRouter<Weight>::RepairAfterWeightChanges(
+    const std::vector<EdgeWeightChange>& changes) {
+    for (const auto& change : changes) {
+        if (graph_.GetEdge(change.edge).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    if (cache_) {
+        cache_->Clear();
+    }
+    return {};
+}
+
+template <typename Weight>
+typename ShortestPathTreeCache<Weight>::Stats DijkstraRouter<Weight>::GetCacheStats() const {
+    return cache_ ? cache_->GetStats() : typename ShortestPathTreeCache<Weight>::Stats{};
+}
+
+}  // namespace graph
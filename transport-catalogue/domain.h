@@ -2,20 +2,29 @@
 
 #include "geo.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace domain {
 
+// Плотные номера остановок и автобусов в порядке добавления в каталог:
+// индексы массивов вместо указателей и поиска по имени
+using StopId = std::uint32_t;
+using BusId = std::uint32_t;
+
 struct Stop {
     std::string stop_name;
     geo::Coordinates stop_coord;
+    StopId stop_id = 0;
 };
 
 struct Bus {
     std::string bus_name;
-    std::vector<Stop*> stops_for_bus;
+    // Остановки маршрута по порядку (для некольцевого — только в прямом направлении)
+    std::vector<StopId> stop_ids;
     bool is_roundtrip;
+    BusId bus_id = 0;
 };
 
 struct BusStat{
@@ -2,6 +2,7 @@
 
 #include "ranges.h"
 
+#include <cstdint>
 #include <cstdlib>
 #include <vector>
 
@@ -10,6 +11,10 @@ namespace graph {
 using VertexId = size_t;
 using EdgeId = size_t;
 
+// Компактные идентификаторы для плотных массивов (таблица маршрутов, CSR)
+using CompactVertexId = std::uint32_t;
+using CompactEdgeId = std::uint32_t;
+
 template <typename Weight>
 struct Edge {
     VertexId from;
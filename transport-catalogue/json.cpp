@@ -471,4 +471,50 @@ void Print(const Document& doc, std::ostream& out) {
     PrintNode (doc.GetRoot(), ctx);
 }
 
+ArrayWriter::ArrayWriter (const PrintContext& ctx)
+    : ctx_(ctx)
+    , inner_ctx_(ctx.Indented()) {
+    ctx_.out << "[\n"sv;
+}
+
+const PrintContext& ArrayWriter::NextItem () {
+    if(is_first_){
+        is_first_ = false;
+    } else {
+        ctx_.out << ",\n"sv;
+    }
+    inner_ctx_.PrintIndent();
+    return inner_ctx_;
+}
+
+void ArrayWriter::Close () {
+    ctx_.out << "\n"sv;
+    ctx_.PrintIndent();
+    ctx_.out << "]"sv;
+}
+
+DictWriter::DictWriter (const PrintContext& ctx)
+    : ctx_(ctx)
+    , inner_ctx_(ctx.Indented()) {
+    ctx_.out << "{\n"sv;
+}
+
+const PrintContext& DictWriter::Key (const std::string& key) {
+    if(is_first_){
+        is_first_ = false;
+    } else {
+        ctx_.out << ",\n"sv;
+    }
+    inner_ctx_.PrintIndent();
+    PrintValue(key, ctx_);
+    ctx_.out << ": "sv;
+    return inner_ctx_;
+}
+
+void DictWriter::Close () {
+    ctx_.out << "\n"sv;
+    ctx_.PrintIndent();
+    ctx_.out << "}"sv;
+}
+
 }  // namespace json
\ No newline at end of file
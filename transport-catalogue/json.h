@@ -104,4 +104,36 @@ void PrintValue (Dict values,       const PrintContext& ctx);
 void PrintNode (const Node& node, const PrintContext& ctx);
 void Print(const Document& doc, std::ostream& out);
 
+// Потоковый вывод массива в том же формате, что PrintValue (Array): элементы
+// печатаются по одному в контекст NextItem(), без сборки json::Array
+class ArrayWriter {
+public:
+    explicit ArrayWriter (const PrintContext& ctx);
+
+    // Разделитель и отступ очередного элемента, возвращает контекст для его вывода
+    const PrintContext& NextItem ();
+    void Close ();
+
+private:
+    PrintContext ctx_;
+    PrintContext inner_ctx_;
+    bool is_first_ = true;
+};
+
+// Потоковый вывод словаря в формате PrintValue (Dict). Ключи передаются
+// в порядке возрастания, как их печатает Dict
+class DictWriter {
+public:
+    explicit DictWriter (const PrintContext& ctx);
+
+    // Печатает ключ, возвращает контекст для вывода значения
+    const PrintContext& Key (const std::string& key);
+    void Close ();
+
+private:
+    PrintContext ctx_;
+    PrintContext inner_ctx_;
+    bool is_first_ = true;
+};
+
 }  // namespace json
\ No newline at end of file
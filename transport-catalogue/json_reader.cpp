@@ -1,6 +1,8 @@
 #include "json_reader.h"
 #include "request_handler.h"
 
+#include <stdexcept>
+#include <string>
 #include <tuple>
 
 namespace json_reader {
@@ -14,10 +16,108 @@ RequestType GetRequestType (std::string request){
         return RequestType::Map;
     } else if (request == "Route") {
         return RequestType::Route;
+    } else if (request == "Matrix") {
+        return RequestType::Matrix;
+    } else if (request == "Isochrone") {
+        return RequestType::Isochrone;
+    } else if (request == "RouterStats") {
+        return RequestType::RouterStats;
     }
     return RequestType::Unknown;
 }
 
+transport_router::RouterType GetRouterType (const std::string& router_type) {
+    if (router_type == "dijkstra") {
+        return transport_router::RouterType::Dijkstra;
+    } else if (router_type == "all_pairs") {
+        return transport_router::RouterType::AllPairs;
+    } else if (router_type == "all_pairs_tiled") {
+        return transport_router::RouterType::AllPairsTiled;
+    } else if (router_type == "contraction_hierarchy") {
+        return transport_router::RouterType::ContractionHierarchy;
+    } else if (router_type == "astar") {
+        return transport_router::RouterType::AStar;
+    }
+    throw std::invalid_argument("Unknown router type: " + router_type);
+}
+
+transport_router::GraphModel GetGraphModel (const std::string& graph_model) {
+    if (graph_model == "span") {
+        return transport_router::GraphModel::Span;
+    } else if (graph_model == "line") {
+        return transport_router::GraphModel::Line;
+    }
+    throw std::invalid_argument("Unknown graph model: " + graph_model);
+}
+
+transport_router::VertexOrder GetVertexOrder (const std::string& vertex_order) {
+    if (vertex_order == "directory") {
+        return transport_router::VertexOrder::Directory;
+    } else if (vertex_order == "hilbert") {
+        return transport_router::VertexOrder::Hilbert;
+    }
+    throw std::invalid_argument("Unknown vertex order: " + vertex_order);
+}
+
+storage::PageSize GetPageSize (const std::string& huge_pages) {
+    if (huge_pages == "none") {
+        return storage::PageSize::Default;
+    } else if (huge_pages == "transparent") {
+        return storage::PageSize::Transparent;
+    } else if (huge_pages == "explicit") {
+        return storage::PageSize::Explicit;
+    }
+    throw std::invalid_argument("Unknown huge pages mode: " + huge_pages);
+}
+
+storage::NumaPlacement GetNumaPlacement (const std::string& numa_placement) {
+    if (numa_placement == "none") {
+        return storage::NumaPlacement::Default;
+    } else if (numa_placement == "interleave") {
+        return storage::NumaPlacement::Interleave;
+    } else if (numa_placement == "local") {
+        return storage::NumaPlacement::Local;
+    }
+    throw std::invalid_argument("Unknown NUMA placement: " + numa_placement);
+}
+
+size_t GetCount (const std::string& name, int value) {
+    if (value < 0) {
+        throw std::invalid_argument("Negative " + name + ": " + std::to_string(value));
+    }
+    return static_cast<size_t>(value);
+}
+
+std::string GetPageSizeName (storage::PageSize page_size) {
+    switch (page_size) {
+        case storage::PageSize::Default : {
+            return "none";
+        }
+        case storage::PageSize::Transparent : {
+            return "transparent";
+        }
+        case storage::PageSize::Explicit : {
+            return "explicit";
+        }
+    }
+    throw std::invalid_argument("Unknown huge pages mode");
+}
+
+std::string GetNumaPlacementName (storage::NumaPlacement numa_placement) {
+    switch (numa_placement) {
+        case storage::NumaPlacement::Default : {
+            return "none";
+        }
+        case storage::NumaPlacement::Interleave : {
+            return "interleave";
+        }
+        case storage::NumaPlacement::Local : {
+            return "local";
+        }
+    }
+    throw std::invalid_argument("Unknown NUMA placement");
+}
+
 const json::Node& JsonReader::GetBaseRequest() {
     if (input_.GetRoot().AsMap().count("base_requests")) {
         return input_.GetRoot().AsMap().at("base_requests");
@@ -46,6 +146,20 @@ const json::Node& JsonReader::GetRouteSettings() {
     return null_;
 }
 
+const json::Node& JsonReader::GetSerializationSettings() {
+    if (input_.GetRoot().AsMap().count("serialization_settings")) {
+        return input_.GetRoot().AsMap().at("serialization_settings");
+    }
+    return null_;
+}
+
+const json::Node& JsonReader::GetUpdateRequest() {
+    if (input_.GetRoot().AsMap().count("update_requests")) {
+        return input_.GetRoot().AsMap().at("update_requests");
+    }
+    return null_;
+}
+
 void JsonReader::ProcessBaseRequest (trans_cat::TransportCatalogue& catalogue) {
     const json::Array& request = GetBaseRequest().AsArray();
     std::vector<json::Node> bus_buffer;
@@ -69,6 +183,15 @@ void JsonReader::ProcessBaseRequest (trans_cat::TransportCatalogue& catalogue) {
             case RequestType::Route : {
                 break;
             }
+            case RequestType::Matrix : {
+                break;
+            }
+            case RequestType::Isochrone : {
+                break;
+            }
+            case RequestType::RouterStats : {
+                break;
+            }
             case RequestType::Unknown : {
                 break;
             }
@@ -80,6 +203,50 @@ void JsonReader::ProcessBaseRequest (trans_cat::TransportCatalogue& catalogue) {
         auto [bus_name, stops_for_bus, is_roundtrip] = GetBusFromRequest(catalogue, bus_node.AsMap());
         catalogue.AddBus(bus_name, stops_for_bus, is_roundtrip);
     }
+    catalogue.Freeze();
+}
+
+void JsonReader::ProcessUpdateRequest (trans_cat::TransportCatalogue& catalogue, transport_router::TransportRouter& router) {
+    using namespace std::literals;
+    if (GetUpdateRequest().IsNull()) {
+        return;
+    }
+
+    // Автобус может проходить через несколько изменённых пар: его рёбра пересчитываются один раз
+    std::vector<bool> is_bus_changed (catalogue.GetBuses().size(), false);
+    const auto update_changed_buses = [&]() {
+        for (domain::BusId bus_id = 0; bus_id < is_bus_changed.size(); ++bus_id) {
+            if (is_bus_changed[bus_id]) {
+                router.UpdateBusEdges(catalogue.GetBusById(bus_id)->bus_name);
+                is_bus_changed[bus_id] = false;
+            }
+        }
+    };
+
+    for (const auto& node : GetUpdateRequest().AsArray()) {
+        const json::Dict& request = node.AsMap();
+        const std::string& type = request.at("type"s).AsString();
+        if (type == "RoutingSettings"s) {
+            // Веса пересчитываются из расстояний рёбер, поэтому сначала применяются накопленные Distance
+            update_changed_buses();
+            router.Recustomize(request.at("bus_wait_time"s).AsInt(), request.at("bus_velocity"s).AsDouble());
+            continue;
+        }
+        if (type != "Distance"s) {
+            throw std::invalid_argument("Unknown update request type: " + type);
+        }
+
+        const domain::Stop* stop_from = catalogue.GetStopByName(request.at("from"s).AsString());
+        const domain::Stop* stop_to   = catalogue.GetStopByName(request.at("to"s).AsString());
+        if (!stop_from || !stop_to) {
+            throw std::invalid_argument("Unknown stop in update request");
+        }
+        catalogue.SetDistBetweenStops(stop_from, stop_to, static_cast<size_t>(request.at("distance"s).AsInt()));
+        for (const domain::BusId bus_id : catalogue.GetBusIdsForStop(stop_from->stop_id)) {
+            is_bus_changed[bus_id] = true;
+        }
+    }
+    update_changed_buses();
 }
 
 map_render::RenderSettings json_reader::JsonReader::ProcessRenderSetting (const json::Dict& request) {
@@ -150,6 +317,46 @@ transport_router::RouteSettings JsonReader::ProcessRouterSetting (const json::Di
     route_settings.bus_wait_time   = request.at("bus_wait_time"s).AsInt();
     route_settings.bus_velocity    = request.at("bus_velocity"s).AsDouble();
 
+    if (request.count("router"s)) {
+        route_settings.router_type = GetRouterType (request.at("router"s).AsString());
+    }
+
+    if (request.count("thread_count"s)) {
+        route_settings.thread_count = GetCount ("thread_count"s, request.at("thread_count"s).AsInt());
+    }
+
+    if (request.count("float_weights"s)) {
+        route_settings.use_float_weights = request.at("float_weights"s).AsBool();
+    }
+
+    if (request.count("landmark_count"s)) {
+        route_settings.landmark_count = GetCount ("landmark_count"s, request.at("landmark_count"s).AsInt());
+    }
+
+    if (request.count("graph_model"s)) {
+        route_settings.graph_model = GetGraphModel (request.at("graph_model"s).AsString());
+    }
+
+    if (request.count("spt_cache_bytes"s)) {
+        route_settings.spt_cache_bytes = GetCount ("spt_cache_bytes"s, request.at("spt_cache_bytes"s).AsInt());
+    }
+
+    if (request.count("table_file"s)) {
+        route_settings.table_file = request.at("table_file"s).AsString();
+    }
+
+    if (request.count("vertex_order"s)) {
+        route_settings.vertex_order = GetVertexOrder (request.at("vertex_order"s).AsString());
+    }
+
+    if (request.count("huge_pages"s)) {
+        route_settings.memory_policy.page_size = GetPageSize (request.at("huge_pages"s).AsString());
+    }
+
+    if (request.count("numa_placement"s)) {
+        route_settings.memory_policy.numa_placement = GetNumaPlacement (request.at("numa_placement"s).AsString());
+    }
+
     return route_settings;
 }
 
@@ -159,9 +366,9 @@ std::pair<std::string, geo::Coordinates> JsonReader::GetStopFromRequest (const j
     return std::make_pair(stop_name, stop_coord);
 }
 
-std::tuple<std::string, std::vector<domain::Stop*>, bool> JsonReader::GetBusFromRequest (trans_cat::TransportCatalogue& catalogue, const json::Dict& request) {
+std::tuple<std::string, std::vector<const domain::Stop*>, bool> JsonReader::GetBusFromRequest (trans_cat::TransportCatalogue& catalogue, const json::Dict& request) {
     std::string bus_name = request.at("name").AsString();
-    std::vector<domain::Stop*> stops_for_bus;
+    std::vector<const domain::Stop*> stops_for_bus;
 
     for (const auto& stop : GetStopsForBusFromRequest(catalogue, request)) {
         stops_for_bus.push_back(stop);
@@ -171,22 +378,23 @@ std::tuple<std::string, std::vector<domain::Stop*>, bool> JsonReader::GetBusFrom
     return std::make_tuple(bus_name, stops_for_bus, is_roundtrip);
 }
 
+// Расстояния до остановок, которых нет в base_requests, пропускаются: по ним нет маршрутов
 void JsonReader::SetDistanceFromRequest (trans_cat::TransportCatalogue& catalogue, json::Array& request){
     for (const auto& stops_dict : request) {
-        std::string stop_from = stops_dict.AsMap().at("name").AsString();
-        std::string stop_to;
-        size_t distance = 0;
+        const domain::Stop* stop_from = catalogue.GetStopByName(stops_dict.AsMap().at("name").AsString());
 
         for (const auto& [stop, dist] : stops_dict.AsMap().at("road_distances").AsMap()) {
-            stop_to = stop;
-            distance = static_cast<size_t>(dist.AsInt());
-            catalogue.SetDistBetweenStops(catalogue.GetStopByName(stop_from), catalogue.GetStopByName(stop_to), distance);
+            const domain::Stop* stop_to = catalogue.GetStopByName(stop);
+            if (!stop_to) {
+                continue;
+            }
+            catalogue.SetDistBetweenStops(stop_from, stop_to, static_cast<size_t>(dist.AsInt()));
         }
     }
 }
 
-std::vector<domain::Stop*> JsonReader::GetStopsForBusFromRequest (trans_cat::TransportCatalogue& catalogue, const json::Dict& request) {
-    std::vector<domain::Stop*> result;
+std::vector<const domain::Stop*> JsonReader::GetStopsForBusFromRequest (trans_cat::TransportCatalogue& catalogue, const json::Dict& request) {
+    std::vector<const domain::Stop*> result;
     
     for (const auto& stop : request.at("stops").AsArray()) {
         result.push_back(catalogue.GetStopByName(stop.AsString()));
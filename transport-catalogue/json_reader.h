@@ -17,11 +17,38 @@ enum class RequestType {
     Stop,
     Map,
     Route,
+    Matrix,
+    Isochrone,
+    // Диагностика маршрутизатора: размер графа и время его построения
+    RouterStats,
     Unknown
 };
 
 RequestType GetRequestType (std::string request);
 
+// Тип движка маршрутизации из routing_settings
+// ("all_pairs" / "all_pairs_tiled" / "dijkstra" / "contraction_hierarchy" / "astar")
+transport_router::RouterType GetRouterType (const std::string& router_type);
+
+// Модель графа маршрутов из routing_settings ("span" / "line")
+transport_router::GraphModel GetGraphModel (const std::string& graph_model);
+
+// Нумерация вершин из routing_settings ("directory" / "hilbert")
+transport_router::VertexOrder GetVertexOrder (const std::string& vertex_order);
+
+// Размер страниц таблиц маршрутизатора из routing_settings ("none" / "transparent" / "explicit")
+storage::PageSize GetPageSize (const std::string& huge_pages);
+
+// Размещение таблиц маршрутизатора по узлам NUMA из routing_settings ("none" / "interleave" / "local")
+storage::NumaPlacement GetNumaPlacement (const std::string& numa_placement);
+
+// Неотрицательное число из routing_settings (потоки, ориентиры, байты кэша)
+size_t GetCount (const std::string& name, int value);
+
+// Обратные преобразования для ответа RouterStats
+std::string GetPageSizeName (storage::PageSize page_size);
+std::string GetNumaPlacementName (storage::NumaPlacement numa_placement);
+
 class JsonReader {
 public:
     JsonReader(std::istream& input)
@@ -33,10 +60,18 @@ public:
     const json::Node& GetStatRequest();
     const json::Node& GetRenderSettings();
     const json::Node& GetRouteSettings();
+    const json::Node& GetSerializationSettings();
+    const json::Node& GetUpdateRequest();
     
     // Обрабока base_processing, заполнение транспортного каталога
     void ProcessBaseRequest (trans_cat::TransportCatalogue& catalogue);
 
+    // Обработка update_requests после построения маршрутизатора, до stat_requests.
+    // Distance — новое расстояние уже известной пары остановок; рёбра автобусов,
+    // проходящих через from, пересчитываются без перестроения графа.
+    // RoutingSettings — новые bus_wait_time и bus_velocity, веса всех рёбер пересчитываются
+    void ProcessUpdateRequest (trans_cat::TransportCatalogue& catalogue, transport_router::TransportRouter& router);
+
     // Заполнение настроек рендера renderer_settings
     map_render::RenderSettings ProcessRenderSetting (const json::Dict& request);
 
@@ -52,13 +87,13 @@ private:
     std::pair<std::string, geo::Coordinates> GetStopFromRequest (const json::Dict& request);
     
     // Получение данных о маршруте
-    std::tuple<std::string, std::vector<domain::Stop*>, bool> GetBusFromRequest (trans_cat::TransportCatalogue& catalogue, const json::Dict& request);
+    std::tuple<std::string, std::vector<const domain::Stop*>, bool> GetBusFromRequest (trans_cat::TransportCatalogue& catalogue, const json::Dict& request);
     
     // Получение данных о расстояних между остановками
     void SetDistanceFromRequest (trans_cat::TransportCatalogue& catalogue, json::Array& request);
     
     // Получение списка остановок для маршрута
-    std::vector<domain::Stop*> GetStopsForBusFromRequest (trans_cat::TransportCatalogue& catalogue, const json::Dict& request);
+    std::vector<const domain::Stop*> GetStopsForBusFromRequest (trans_cat::TransportCatalogue& catalogue, const json::Dict& request);
 };
 
 } // namespace json_reader
@@ -1,25 +1,96 @@
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
 
 #include "json_reader.h"
+#include "snapshot.h"
 #include "transport_catalogue.h"
 #include "request_handler.h"
 
-int main() {
+namespace {
+
+// Построение справочника и маршрутизатора и запись их в снимок serialization_settings.file.
+// Настройки рендера небольшие и хранятся в снимке текстом JSON
+void MakeBase (json_reader::JsonReader& reader) {
+    trans_cat::TransportCatalogue tc;
+    reader.ProcessBaseRequest(tc);
+
+    const auto& route_settings = reader.ProcessRouterSetting (reader.GetRouteSettings ().AsMap ());
+    transport_router::TransportRouter router (tc, route_settings);
+    reader.ProcessUpdateRequest (tc, router);
+
+    std::ostringstream render_settings;
+    json::Print (json::Document{reader.GetRenderSettings()}, render_settings);
+
+    snapshot::Writer writer (reader.GetSerializationSettings().AsMap().at("file").AsString());
+    writer.WriteString (render_settings.str());
+    tc.Save (writer);
+    router.Save (writer);
+    writer.Finish ();
+}
+
+// Ответы на stat_requests по снимку (после update_requests), без разбора base_requests
+// и построения графа
+void ProcessRequests (json_reader::JsonReader& reader) {
+    snapshot::Reader snapshot_reader (reader.GetSerializationSettings().AsMap().at("file").AsString());
+
+    std::istringstream render_settings_input {std::string (snapshot_reader.ReadString ())};
+    const auto render_settings_node = json::Load (render_settings_input);
+
+    trans_cat::TransportCatalogue tc;
+    tc.Load (snapshot_reader);
+    transport_router::TransportRouter router (tc, snapshot_reader);
+    reader.ProcessUpdateRequest (tc, router);
+
+    map_render::MapRender mr (reader.ProcessRenderSetting (render_settings_node.GetRoot().AsMap()));
+    req_handl::RequestHandler rh (tc, mr, router);
+
+    rh.ProcessStatRequest (reader.GetStatRequest ());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
     using namespace std::literals;
     /*
      * Примерная структура программы:
      *
      * Считать JSON из stdin
      * Построить на его основе JSON базу данных транспортного справочника
+     * Применить изменения из массива "update_requests"
      * Выполнить запросы к справочнику, находящиеся в массива "stat_requests", построив JSON-массив
      * с ответами Вывести в stdout ответы в виде JSON
+     *
+     * Режимы make_base / process_requests разделяют построение и ответы через снимок
      */
 
-    trans_cat::TransportCatalogue tc;
     json_reader::JsonReader reader(std::cin);
 
+    if (argc == 2) {
+        const std::string_view mode(argv[1]);
+        if (mode == "make_base"sv) {
+            MakeBase (reader);
+            return 0;
+        }
+        if (mode == "process_requests"sv) {
+            // Повреждённый или обрезанный снимок — ошибка входных данных, а не аварийное завершение
+            try {
+                ProcessRequests (reader);
+            } catch (const std::runtime_error& error) {
+                std::cerr << "process_requests: "sv << error.what() << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+        std::cerr << "Usage: transport_catalogue [make_base|process_requests]"sv << std::endl;
+        return 1;
+    }
+
+    trans_cat::TransportCatalogue tc;
+
     reader.ProcessBaseRequest(tc);
 
     const auto& render_settings_node = reader.GetRenderSettings().AsMap();
@@ -31,8 +102,9 @@ int main() {
     map_render::MapRender mr (render_settings);
 
     transport_router::TransportRouter router (tc, route_settings);
+    reader.ProcessUpdateRequest (tc, router);
     
     req_handl::RequestHandler rh (tc, mr, router);
 
     rh.ProcessStatRequest (reader.GetStatRequest ());
-}
\ No newline at end of file
+}
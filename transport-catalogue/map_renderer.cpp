@@ -1,7 +1,6 @@
 #include "map_renderer.h"
 
 #include <algorithm>
-#include <set>
 /*
  * В этом файле вы можете разместить код, отвечающий за визуализацию карты маршрутов в формате SVG.
  * Визуализация маршртутов вам понадобится во второй части итогового проекта.
@@ -14,32 +13,38 @@ bool IsZero(double value) {
     return std::abs(value) < EPSILON;
 }
 
-svg::Document MapRender::GetMapRender (const std::map<std::string_view, domain::Bus*>& buses) const {
+svg::Document MapRender::GetMapRender (const std::vector<const domain::Bus*>& buses, const std::deque<domain::Stop>& stops) const {
     svg::Document result;
     std::vector<geo::Coordinates> bus_stops_coord;
-    std::map<std::string_view, domain::Stop*> all_stops;
+    std::vector<bool> is_bus_stop (stops.size(), false);
 
-    for (const auto& [bus_name, bus] : buses) {
-        
-        if (bus->stops_for_bus.empty()) {
-            continue;
+    for (const domain::Bus* bus : buses) {
+        for (const domain::StopId stop_id : bus->stop_ids) {
+            bus_stops_coord.push_back(stops[stop_id].stop_coord);
+            is_bus_stop[stop_id] = true;
         }
+    }
 
-        for (const auto& stop : bus->stops_for_bus) {
-            bus_stops_coord.push_back(stop->stop_coord);
-            all_stops[stop->stop_name] = stop;
+    // Остановки маршрутов в алфавитном порядке
+    std::vector<const domain::Stop*> all_stops;
+    for (const domain::Stop& stop : stops) {
+        if (is_bus_stop[stop.stop_id]) {
+            all_stops.push_back(&stop);
         }
     }
+    std::sort(all_stops.begin(), all_stops.end(), [](const domain::Stop* lhs, const domain::Stop* rhs) {
+        return lhs->stop_name < rhs->stop_name;
+    });
 
     SphereProjector projector (bus_stops_coord.begin(), bus_stops_coord.end()
                                , render_settings_.width, render_settings_.height 
                                , render_settings_.padding);
 
-    for(const auto& line : DrawRoughtlines (buses, projector)) {
+    for(const auto& line : DrawRoughtlines (buses, stops, projector)) {
         result.Add(line);
     }
 
-    for(const auto& bus_name : DrawBusNames (buses, projector)) {
+    for(const auto& bus_name : DrawBusNames (buses, stops, projector)) {
         result.Add(bus_name);
     }
 
@@ -54,20 +59,20 @@ svg::Document MapRender::GetMapRender (const std::map<std::string_view, domain::
     return result;
 }
 
-std::vector<svg::Polyline> MapRender::DrawRoughtlines (const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& projector) const {
+std::vector<svg::Polyline> MapRender::DrawRoughtlines (const std::vector<const domain::Bus*>& buses, const std::deque<domain::Stop>& stops, const SphereProjector& projector) const {
     std::vector<svg::Polyline> result;
     size_t color_num = 0;
 
-    for (const auto& [bus_name, bus] : buses) {
+    for (const domain::Bus* bus : buses) {
         svg::Polyline line;
-        std::vector<domain::Stop*> stops_for_bus {bus->stops_for_bus.begin(), bus->stops_for_bus.end()};
+        std::vector<domain::StopId> stop_ids {bus->stop_ids.begin(), bus->stop_ids.end()};
         
-        if (!bus->is_roundtrip) {
-            stops_for_bus.insert(stops_for_bus.end(), std::next(bus->stops_for_bus.rbegin()), bus->stops_for_bus.rend());   
+        if (!bus->is_roundtrip && !bus->stop_ids.empty()) {
+            stop_ids.insert(stop_ids.end(), std::next(bus->stop_ids.rbegin()), bus->stop_ids.rend());   
         }
 
-        for (const auto& stop : stops_for_bus) {
-            line.AddPoint (projector(stop->stop_coord));
+        for (const domain::StopId stop_id : stop_ids) {
+            line.AddPoint (projector(stops[stop_id].stop_coord));
         }
 
         line.SetStrokeColor (render_settings_.color_palette[color_num]);
@@ -88,7 +93,7 @@ std::vector<svg::Polyline> MapRender::DrawRoughtlines (const std::map<std::strin
     return result;
 }
 
-std::vector<svg::Text> MapRender::DrawBusNames (const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& projector) const {
+std::vector<svg::Text> MapRender::DrawBusNames (const std::vector<const domain::Bus*>& buses, const std::deque<domain::Stop>& stops, const SphereProjector& projector) const {
     using namespace std::literals;
     
     std::vector<svg::Text> result;
@@ -97,10 +102,14 @@ std::vector<svg::Text> MapRender::DrawBusNames (const std::map<std::string_view,
     svg::Text frst_underlayer;
     svg::Text frst_final_stop;
 
-    for (const auto& [bus_name, bus] : buses) {
-        std::vector<domain::Stop*> stops_for_bus {bus->stops_for_bus.begin(), bus->stops_for_bus.end()};
+    for (const domain::Bus* bus : buses) {
+        if (bus->stop_ids.empty()) {
+            continue;
+        }
+        const domain::Stop& first_stop = stops[bus->stop_ids.front()];
+        const domain::Stop& last_stop  = stops[bus->stop_ids.back()];
         
-        frst_underlayer.SetPosition (projector(stops_for_bus.begin().operator*()->stop_coord));
+        frst_underlayer.SetPosition (projector(first_stop.stop_coord));
         frst_underlayer.SetOffset (render_settings_.bus_label_offset);
         frst_underlayer.SetFontSize (static_cast<uint32_t>(render_settings_.bus_label_font_size));
         frst_underlayer.SetFontFamily ("Verdana"s);
@@ -112,7 +121,7 @@ std::vector<svg::Text> MapRender::DrawBusNames (const std::map<std::string_view,
         frst_underlayer.SetStrokeLineCap (svg::StrokeLineCap::ROUND);
         frst_underlayer.SetStrokeLineJoin (svg::StrokeLineJoin::ROUND);
 
-        frst_final_stop.SetPosition (projector(stops_for_bus.begin().operator*()->stop_coord));
+        frst_final_stop.SetPosition (projector(first_stop.stop_coord));
         frst_final_stop.SetOffset (render_settings_.bus_label_offset);
         frst_final_stop.SetFontSize (static_cast<uint32_t>(render_settings_.bus_label_font_size));
         frst_final_stop.SetFontFamily ("Verdana"s);
@@ -123,12 +132,12 @@ std::vector<svg::Text> MapRender::DrawBusNames (const std::map<std::string_view,
         result.push_back (frst_underlayer);
         result.push_back (frst_final_stop);
 
-        if (!bus->is_roundtrip && stops_for_bus.begin().operator*() != stops_for_bus.rbegin().operator*()) {
+        if (!bus->is_roundtrip && &first_stop != &last_stop) {
             svg::Text lst_underlayer {frst_underlayer};
             svg::Text lst_final_stop {frst_final_stop};
 
-            lst_underlayer.SetPosition (projector(stops_for_bus.rbegin().operator*()->stop_coord));
-            lst_final_stop.SetPosition (projector(stops_for_bus.rbegin().operator*()->stop_coord));
+            lst_underlayer.SetPosition (projector(last_stop.stop_coord));
+            lst_final_stop.SetPosition (projector(last_stop.stop_coord));
 
             result.push_back (lst_underlayer);
             result.push_back (lst_final_stop);
@@ -143,11 +152,11 @@ std::vector<svg::Text> MapRender::DrawBusNames (const std::map<std::string_view,
     return result;
 }
 
-std::vector<svg::Circle> MapRender::DrawStopSymbols (const std::map<std::string_view, domain::Stop*>& all_stops, const SphereProjector& projector) const {
+std::vector<svg::Circle> MapRender::DrawStopSymbols (const std::vector<const domain::Stop*>& all_stops, const SphereProjector& projector) const {
     using namespace std::literals;
     std::vector<svg::Circle> result;
 
-    for (const auto& [stop_name, stop] : all_stops) {
+    for (const domain::Stop* stop : all_stops) {
         svg::Circle stop_symbol;
 
         stop_symbol.SetCenter (projector(stop->stop_coord));
@@ -159,13 +168,13 @@ std::vector<svg::Circle> MapRender::DrawStopSymbols (const std::map<std::string_
     return result;
 }
 
-std::vector<svg::Text> MapRender::DrawStopNames (const std::map<std::string_view, domain::Stop*>& all_stops, const SphereProjector& projector) const {
+std::vector<svg::Text> MapRender::DrawStopNames (const std::vector<const domain::Stop*>& all_stops, const SphereProjector& projector) const {
     using namespace std::literals;
     std::vector<svg::Text> result;
     svg::Text stop_underlayer;
     svg::Text stop_name;
 
-    for (const auto& [name, stop] : all_stops) {
+    for (const domain::Stop* stop : all_stops) {
         stop_underlayer.SetPosition (projector(stop->stop_coord));
         stop_underlayer.SetOffset (render_settings_.stop_label_offset);
         stop_underlayer.SetFontSize (static_cast<uint32_t>(render_settings_.stop_label_font_size));
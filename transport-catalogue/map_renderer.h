@@ -7,8 +7,8 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <deque>
 #include <iostream>
-#include <map>
 #include <optional>
 #include <vector>
 
@@ -116,15 +116,16 @@ public:
         : render_settings_(settings){
     }
     
-    svg::Document GetMapRender (const std::map<std::string_view, domain::Bus*>& buses) const;
+    // stops — все остановки по номерам: stops[stop_id]
+    svg::Document GetMapRender (const std::vector<const domain::Bus*>& buses, const std::deque<domain::Stop>& stops) const;
 
 private:
     RenderSettings render_settings_;
     
-    std::vector<svg::Polyline> DrawRoughtlines (const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& projector) const;
-    std::vector<svg::Text>     DrawBusNames    (const std::map<std::string_view, domain::Bus*>& buses, const SphereProjector& projector) const;
-    std::vector<svg::Circle>   DrawStopSymbols (const std::map<std::string_view, domain::Stop*>& all_stops, const SphereProjector& projector) const;
-    std::vector<svg::Text>     DrawStopNames   (const std::map<std::string_view, domain::Stop*>& all_stops, const SphereProjector& projector) const;
+    std::vector<svg::Polyline> DrawRoughtlines (const std::vector<const domain::Bus*>& buses, const std::deque<domain::Stop>& stops, const SphereProjector& projector) const;
+    std::vector<svg::Text>     DrawBusNames    (const std::vector<const domain::Bus*>& buses, const std::deque<domain::Stop>& stops, const SphereProjector& projector) const;
+    std::vector<svg::Circle>   DrawStopSymbols (const std::vector<const domain::Stop*>& all_stops, const SphereProjector& projector) const;
+    std::vector<svg::Text>     DrawStopNames   (const std::vector<const domain::Stop*>& all_stops, const SphereProjector& projector) const;
 };
 
 } // namespace map_render
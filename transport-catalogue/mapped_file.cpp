@@ -0,0 +1,368 @@
+#include "mapped_file.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace storage {
+
+MappedFile::MappedFile (std::byte* data, size_t size)
+    : data_(data)
+    , size_(size)
+    , mapping_size_(size) {
+}
+
+MappedFile::MappedFile (MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+    , mapping_size_(std::exchange(other.mapping_size_, 0))
+    , memory_policy_(std::exchange(other.memory_policy_, {}))
+    , write_back_path_(std::move(other.write_back_path_)) {
+}
+
+MappedFile& MappedFile::operator= (MappedFile&& other) noexcept {
+    if (this != &other) {
+        Release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapping_size_ = std::exchange(other.mapping_size_, 0);
+        memory_policy_ = std::exchange(other.memory_policy_, {});
+        write_back_path_ = std::move(other.write_back_path_);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile () {
+    Release();
+}
+
+#ifdef __linux__
+
+namespace {
+
+constexpr size_t DEFAULT_HUGE_PAGE_SIZE = size_t{2} << 20;
+
+// Маски узлов для mbind / get_mempolicy; узлов больше не бывает на практике
+constexpr unsigned long MAX_NUMA_NODES = 1024;
+constexpr size_t MASK_WORD_BITS = sizeof(unsigned long) * 8;
+using NodeMask = std::array<unsigned long, MAX_NUMA_NODES / MASK_WORD_BITS>;
+
+size_t AlignUp (size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t AlignDown (size_t value, size_t alignment) {
+    return value / alignment * alignment;
+}
+
+// Размер огромной страницы по умолчанию (Hugepagesize из /proc/meminfo)
+size_t GetHugePageSize () {
+    static const size_t huge_page_size = [] {
+        std::ifstream meminfo("/proc/meminfo");
+        const std::string key = "Hugepagesize:";
+        for (std::string line; std::getline(meminfo, line); ) {
+            if (line.compare(0, key.size(), key) == 0) {
+                const size_t size_kb = std::stoul(line.substr(key.size()));
+                return size_kb > 0 ? size_kb * 1024 : DEFAULT_HUGE_PAGE_SIZE;
+            }
+        }
+        return DEFAULT_HUGE_PAGE_SIZE;
+    }();
+    return huge_page_size;
+}
+
+// THP доступны, если не выключены совсем ("always" или "madvise")
+bool IsTransparentHugePagesEnabled () {
+    static const bool enabled = [] {
+        std::ifstream input("/sys/kernel/mm/transparent_hugepage/enabled");
+        std::string mode;
+        std::getline(input, mode);
+        return !mode.empty() && mode.find("[never]") == std::string::npos;
+    }();
+    return enabled;
+}
+
+// Огромные страницы возможны только в выровненной по ним части блока;
+// false, если THP выключены или такой части нет
+bool AdviseHugePages (void* data, size_t size) {
+    if (!IsTransparentHugePagesEnabled()) {
+        return false;
+    }
+    const auto address = reinterpret_cast<std::uintptr_t>(data);
+    const size_t begin = AlignUp(address, GetHugePageSize());
+    const size_t end = AlignDown(address + size, GetHugePageSize());
+    return begin < end && madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) == 0;
+}
+
+// Узлы, на которых процессу разрешено выделять память; пусто, если NUMA недоступна
+NodeMask GetAllowedNodes () {
+    NodeMask nodes{};
+    if (syscall(SYS_get_mempolicy, nullptr, nodes.data(), MAX_NUMA_NODES + 1, nullptr, MPOL_F_MEMS_ALLOWED) != 0) {
+        nodes.fill(0);
+    }
+    return nodes;
+}
+
+size_t CountNodes (const NodeMask& nodes) {
+    size_t count = 0;
+    for (const unsigned long word : nodes) {
+        count += static_cast<size_t>(__builtin_popcountl(word));
+    }
+    return count;
+}
+
+// Политика NUMA для страниц блока (вызовы mbind без libnuma). С одним узлом
+// размещать нечего, политика не ставится. flags = MPOL_MF_MOVE переносит уже
+// выделенные страницы
+bool BindNumaNodes (void* data, size_t size, NumaPlacement placement, unsigned flags) {
+    const NodeMask allowed_nodes = GetAllowedNodes();
+    if (CountNodes(allowed_nodes) < 2) {
+        return false;
+    }
+
+    int mode = MPOL_INTERLEAVE;
+    NodeMask nodes = allowed_nodes;
+    if (placement == NumaPlacement::Local) {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= MAX_NUMA_NODES) {
+            return false;
+        }
+        mode = MPOL_PREFERRED;
+        nodes.fill(0);
+        nodes[node / MASK_WORD_BITS] |= 1ul << (node % MASK_WORD_BITS);
+    }
+
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto address = reinterpret_cast<std::uintptr_t>(data);
+    const size_t begin = AlignUp(address, page_size);
+    const size_t end = AlignDown(address + size, page_size);
+    return begin < end
+        && syscall(SYS_mbind, begin, end - begin, mode, nodes.data(), MAX_NUMA_NODES + 1, flags) == 0;
+}
+
+} // namespace
+
+MemoryPolicy ApplyMemoryPolicy (void* data, size_t size, const MemoryPolicy& policy) {
+    MemoryPolicy applied;
+    if (policy.numa_placement != NumaPlacement::Default && BindNumaNodes(data, size, policy.numa_placement, MPOL_MF_MOVE)) {
+        applied.numa_placement = policy.numa_placement;
+    }
+    if (policy.page_size != PageSize::Default && AdviseHugePages(data, size)) {
+        applied.page_size = PageSize::Transparent;
+    }
+    return applied;
+}
+
+size_t GetPageFaultCount () {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(usage.ru_minflt) + static_cast<size_t>(usage.ru_majflt);
+}
+
+MappedFile MappedFile::OpenPrivate (const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot stat file: " + path);
+    }
+    const auto size = static_cast<size_t>(file_stat.st_size);
+    if (size == 0) {
+        close(fd);
+        return {};
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+    return {static_cast<std::byte*>(data), size};
+}
+
+MappedFile MappedFile::Create (const std::string& path, size_t size) {
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create file: " + path);
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot resize file: " + path);
+    }
+    if (size == 0) {
+        close(fd);
+        return {};
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+    return {static_cast<std::byte*>(data), size};
+}
+
+MappedFile MappedFile::Allocate (size_t size, const MemoryPolicy& policy) {
+    if (size == 0) {
+        return {};
+    }
+    MappedFile file;
+    const size_t huge_page_size = GetHugePageSize();
+
+    if (policy.page_size == PageSize::Explicit) {
+        const size_t mapping_size = AlignUp(size, huge_page_size);
+        void* data = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            file = MappedFile(static_cast<std::byte*>(data), size);
+            file.mapping_size_ = mapping_size;
+            file.memory_policy_.page_size = PageSize::Explicit;
+        }
+    }
+
+    if (!file.data_) {
+        // Для огромных страниц отображение с запасом, чтобы выровнять начало блока по ним
+        const bool use_huge_pages = policy.page_size != PageSize::Default;
+        const size_t mapping_size = use_huge_pages ? AlignUp(size, huge_page_size) : size;
+        const size_t reserved_size = use_huge_pages ? mapping_size + huge_page_size : mapping_size;
+        void* reserved = mmap(nullptr, reserved_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED) {
+            throw std::runtime_error("Cannot allocate " + std::to_string(size) + " bytes");
+        }
+
+        const auto reserved_begin = reinterpret_cast<std::uintptr_t>(reserved);
+        const size_t begin = use_huge_pages ? AlignUp(reserved_begin, huge_page_size) : reserved_begin;
+        const size_t end = begin + mapping_size;
+        if (begin > reserved_begin) {
+            munmap(reserved, begin - reserved_begin);
+        }
+        if (reserved_begin + reserved_size > end) {
+            munmap(reinterpret_cast<void*>(end), reserved_begin + reserved_size - end);
+        }
+
+        file = MappedFile(reinterpret_cast<std::byte*>(begin), size);
+        file.mapping_size_ = mapping_size;
+        if (use_huge_pages && AdviseHugePages(file.data_, mapping_size)) {
+            file.memory_policy_.page_size = PageSize::Transparent;
+        }
+    }
+
+    // До первого обращения: страницы сразу выделяются на нужных узлах
+    if (policy.numa_placement != NumaPlacement::Default
+        && BindNumaNodes(file.data_, file.mapping_size_, policy.numa_placement, 0)) {
+        file.memory_policy_.numa_placement = policy.numa_placement;
+    }
+    return file;
+}
+
+void MappedFile::Release () {
+    if (data_) {
+        munmap(data_, mapping_size_);
+        data_ = nullptr;
+    }
+}
+
+void MappedFile::AdviseRandomAccess () const {
+    if (data_) {
+        madvise(data_, size_, MADV_RANDOM);
+    }
+}
+
+#else
+
+// Без mmap: блоки в куче, файлы читаются целиком, а файл Create записывается
+// при освобождении блока. Огромные страницы и NUMA не поддерживаются
+
+namespace {
+
+// Как у страниц отображения: массивы снимка выровнены относительно начала блока
+constexpr std::align_val_t BLOCK_ALIGNMENT{4096};
+
+std::byte* AllocateBlock (size_t size) {
+    auto* data = static_cast<std::byte*>(::operator new(size, BLOCK_ALIGNMENT));
+    std::memset(data, 0, size);
+    return data;
+}
+
+} // namespace
+
+MemoryPolicy ApplyMemoryPolicy (void*, size_t, const MemoryPolicy&) {
+    return {};
+}
+
+size_t GetPageFaultCount () {
+    return 0;
+}
+
+MappedFile MappedFile::OpenPrivate (const std::string& path) {
+    std::ifstream input(path, std::ios::binary | std::ios::ate);
+    if (!input) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    const auto size = static_cast<size_t>(input.tellg());
+    if (size == 0) {
+        return {};
+    }
+    MappedFile file(AllocateBlock(size), size);
+    input.seekg(0);
+    if (!input.read(reinterpret_cast<char*>(file.data_), static_cast<std::streamsize>(size))) {
+        throw std::runtime_error("Cannot read file: " + path);
+    }
+    return file;
+}
+
+MappedFile MappedFile::Create (const std::string& path, size_t size) {
+    if (!std::ofstream(path, std::ios::binary | std::ios::trunc)) {
+        throw std::runtime_error("Cannot create file: " + path);
+    }
+    if (size == 0) {
+        return {};
+    }
+    MappedFile file(AllocateBlock(size), size);
+    file.write_back_path_ = path;
+    return file;
+}
+
+MappedFile MappedFile::Allocate (size_t size, const MemoryPolicy&) {
+    if (size == 0) {
+        return {};
+    }
+    return MappedFile(AllocateBlock(size), size);
+}
+
+void MappedFile::Release () {
+    if (!data_) {
+        return;
+    }
+    if (!write_back_path_.empty()) {
+        std::ofstream output(write_back_path_, std::ios::binary | std::ios::trunc);
+        output.write(reinterpret_cast<const char*>(data_), static_cast<std::streamsize>(size_));
+        write_back_path_.clear();
+    }
+    ::operator delete(data_, BLOCK_ALIGNMENT);
+    data_ = nullptr;
+}
+
+void MappedFile::AdviseRandomAccess () const {
+}
+
+#endif
+
+} // namespace storage
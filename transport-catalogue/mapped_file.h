@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace storage {
+
+// Размер страниц больших блоков с доступом вразброс: с огромными страницами
+// один элемент TLB покрывает 2 МБ вместо 4 КБ
+enum class PageSize : std::uint8_t {
+    Default,
+    // Прозрачные огромные страницы (THP), если ядро их разрешает через madvise
+    Transparent,
+    // Явные огромные страницы (MAP_HUGETLB) из пула vm.nr_hugepages;
+    // при пустом пуле — прозрачные
+    Explicit
+};
+
+// Размещение страниц по узлам NUMA
+enum class NumaPlacement : std::uint8_t {
+    Default,
+    // Поочерёдно на всех доступных узлах: потоки всех сокетов читают с равной скоростью
+    Interleave,
+    // На узле вызывающего потока (предпочтительно, при нехватке памяти — на соседних)
+    Local
+};
+
+// Политика размещения блока. Недоступная часть политики (нет пула огромных
+// страниц, THP выключены, один узел NUMA) заменяется на Default
+struct MemoryPolicy {
+    PageSize page_size = PageSize::Default;
+    NumaPlacement numa_placement = NumaPlacement::Default;
+};
+
+// Применяет политику к уже выделенной памяти [data, data + size): огромные
+// страницы — только прозрачные, страницы NUMA переносятся на нужные узлы.
+// Возвращает применённую политику
+MemoryPolicy ApplyMemoryPolicy (void* data, size_t size, const MemoryPolicy& policy);
+
+// Число отказов страниц процесса (с чтением с диска и без) с его запуска
+size_t GetPageFaultCount ();
+
+// Файл, отображённый в память целиком. Какие страницы держать в памяти,
+// решает страничный кэш ядра, поэтому отображение может быть больше ОЗУ.
+// Вне Linux файл читается в память целиком, а политика размещения не применяется.
+class MappedFile {
+public:
+    // Приватное отображение существующего файла: запись в память не меняет файл
+    static MappedFile OpenPrivate (const std::string& path);
+
+    // Новый файл размера size (старый перезаписывается) с общим отображением:
+    // записанное в память попадает в файл и может быть вытеснено на диск
+    static MappedFile Create (const std::string& path, size_t size);
+
+    // Анонимный обнулённый блок размера size без файла, размещённый по политике
+    static MappedFile Allocate (size_t size, const MemoryPolicy& policy);
+
+    MappedFile () = default;
+    MappedFile (MappedFile&& other) noexcept;
+    MappedFile& operator= (MappedFile&& other) noexcept;
+    MappedFile (const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+    ~MappedFile ();
+
+    std::byte* GetData () const {
+        return data_;
+    }
+    size_t GetSize () const {
+        return size_;
+    }
+
+    // Подсказка ядру: обращения случайные, упреждающее чтение не нужно
+    void AdviseRandomAccess () const;
+
+    // Политика, с которой размещён блок (Default для отображений файлов)
+    const MemoryPolicy& GetMemoryPolicy () const {
+        return memory_policy_;
+    }
+
+private:
+    MappedFile (std::byte* data, size_t size);
+
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+    // Длина отображения: у огромных страниц она округлена до их размера
+    size_t mapping_size_ = 0;
+    MemoryPolicy memory_policy_;
+    // Файл, куда блок Create записывается при освобождении (без mmap)
+    std::string write_back_path_;
+
+    void Release ();
+};
+
+} // namespace storage
@@ -0,0 +1,120 @@
+#include "min_plus.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIN_PLUS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace graph::min_plus {
+
+namespace {
+
+#ifdef MIN_PLUS_AVX2
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2 (double* weights_from, CompactEdgeId* prev_edges_from,
+                   double weight_through, CompactEdgeId prev_edge_through,
+                   const double* weights_to, const CompactEdgeId* prev_edges_to, size_t count) {
+    const __m256d through = _mm256_set1_pd(weight_through);
+    const __m128i prev_through = _mm_set1_epi32(static_cast<int>(prev_edge_through));
+    const __m128i no_edge = _mm_set1_epi32(static_cast<int>(RoutesTable<double>::NO_EDGE));
+    // Младшие половины 64-битных масок сравнения -> 4 маски по 32 бита
+    const __m256i narrow_mask = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d current = _mm256_loadu_pd(weights_from + i);
+        const __m256d candidate = _mm256_add_pd(through, _mm256_loadu_pd(weights_to + i));
+        const __m256d mask = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(mask) == 0) {
+            continue;
+        }
+        _mm256_storeu_pd(weights_from + i, _mm256_blendv_pd(current, candidate, mask));
+
+        const __m128i prev_to = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges_to + i));
+        const __m128i prev_candidate = _mm_blendv_epi8(prev_to, prev_through, _mm_cmpeq_epi32(prev_to, no_edge));
+        const __m128i prev_mask = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_castpd_si256(mask), narrow_mask));
+        const __m128i prev_current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges_from + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(prev_edges_from + i),
+                         _mm_blendv_epi8(prev_current, prev_candidate, prev_mask));
+    }
+    RelaxRowScalar(weights_from + i, prev_edges_from + i, weight_through, prev_edge_through,
+                   weights_to + i, prev_edges_to + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2 (float* weights_from, CompactEdgeId* prev_edges_from,
+                   float weight_through, CompactEdgeId prev_edge_through,
+                   const float* weights_to, const CompactEdgeId* prev_edges_to, size_t count) {
+    const __m256 through = _mm256_set1_ps(weight_through);
+    const __m256i prev_through = _mm256_set1_epi32(static_cast<int>(prev_edge_through));
+    const __m256i no_edge = _mm256_set1_epi32(static_cast<int>(RoutesTable<float>::NO_EDGE));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 current = _mm256_loadu_ps(weights_from + i);
+        const __m256 candidate = _mm256_add_ps(through, _mm256_loadu_ps(weights_to + i));
+        const __m256 mask = _mm256_cmp_ps(candidate, current, _CMP_LT_OQ);
+        if (_mm256_movemask_ps(mask) == 0) {
+            continue;
+        }
+        _mm256_storeu_ps(weights_from + i, _mm256_blendv_ps(current, candidate, mask));
+
+        const __m256i prev_to = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev_edges_to + i));
+        const __m256i prev_candidate = _mm256_blendv_epi8(prev_to, prev_through, _mm256_cmpeq_epi32(prev_to, no_edge));
+        const __m256i prev_current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev_edges_from + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(prev_edges_from + i),
+                            _mm256_blendv_epi8(prev_current, prev_candidate, _mm256_castps_si256(mask)));
+    }
+    RelaxRowScalar(weights_from + i, prev_edges_from + i, weight_through, prev_edge_through,
+                   weights_to + i, prev_edges_to + i, count - i);
+}
+
+#endif
+
+bool DetectAvx2 () {
+#ifdef MIN_PLUS_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+template <typename StoredWeight>
+using RelaxRowFunction = void (*)(StoredWeight*, CompactEdgeId*, StoredWeight, CompactEdgeId,
+                                  const StoredWeight*, const CompactEdgeId*, size_t);
+
+template <typename StoredWeight>
+RelaxRowFunction<StoredWeight> SelectRelaxRow () {
+#ifdef MIN_PLUS_AVX2
+    if (HasAvx2()) {
+        return static_cast<RelaxRowFunction<StoredWeight>>(&RelaxRowAvx2);
+    }
+#endif
+    return &RelaxRowScalar<StoredWeight>;
+}
+
+} // namespace
+
+bool HasAvx2 () {
+    static const bool has_avx2 = DetectAvx2();
+    return has_avx2;
+}
+
+void RelaxRow (double* weights_from, CompactEdgeId* prev_edges_from,
+               double weight_through, CompactEdgeId prev_edge_through,
+               const double* weights_to, const CompactEdgeId* prev_edges_to, size_t count) {
+    static const RelaxRowFunction<double> relax_row = SelectRelaxRow<double>();
+    relax_row(weights_from, prev_edges_from, weight_through, prev_edge_through, weights_to, prev_edges_to, count);
+}
+
+void RelaxRow (float* weights_from, CompactEdgeId* prev_edges_from,
+               float weight_through, CompactEdgeId prev_edge_through,
+               const float* weights_to, const CompactEdgeId* prev_edges_to, size_t count) {
+    static const RelaxRowFunction<float> relax_row = SelectRelaxRow<float>();
+    relax_row(weights_from, prev_edges_from, weight_through, prev_edge_through, weights_to, prev_edges_to, count);
+}
+
+} // namespace graph::min_plus
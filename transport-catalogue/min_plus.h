@@ -0,0 +1,40 @@
+#pragma once
+
+#include "routes_table.h"
+
+#include <cstddef>
+
+namespace graph::min_plus {
+
+// Min-plus обновление отрезка строки таблицы маршрутов через промежуточную вершину:
+//   weights_from[j] = min(weights_from[j], weight_through + weights_to[j])
+// при улучшении последним ребром маршрута становится prev_edges_to[j],
+// а если его нет (j — сама промежуточная вершина) — prev_edge_through.
+template <typename StoredWeight>
+void RelaxRowScalar(StoredWeight* weights_from, CompactEdgeId* prev_edges_from,
+                    StoredWeight weight_through, CompactEdgeId prev_edge_through,
+                    const StoredWeight* weights_to, const CompactEdgeId* prev_edges_to, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const StoredWeight candidate_weight = weight_through + weights_to[i];
+        if (candidate_weight < weights_from[i]) {
+            weights_from[i] = candidate_weight;
+            prev_edges_from[i] =
+                prev_edges_to[i] != RoutesTable<StoredWeight>::NO_EDGE ? prev_edges_to[i] : prev_edge_through;
+        }
+    }
+}
+
+// Векторизованные версии (AVX2), реализация выбирается при первом вызове по CPUID.
+// На процессорах без AVX2 и на других архитектурах используется RelaxRowScalar.
+void RelaxRow(double* weights_from, CompactEdgeId* prev_edges_from,
+              double weight_through, CompactEdgeId prev_edge_through,
+              const double* weights_to, const CompactEdgeId* prev_edges_to, size_t count);
+
+void RelaxRow(float* weights_from, CompactEdgeId* prev_edges_from,
+              float weight_through, CompactEdgeId prev_edge_through,
+              const float* weights_to, const CompactEdgeId* prev_edges_to, size_t count);
+
+// Доступен ли AVX2-вариант на текущем процессоре
+bool HasAvx2 ();
+
+}  // namespace graph::min_plus
@@ -2,13 +2,15 @@
 #include "request_handler.h"
 
 #include <sstream>
+#include <unordered_map>
 
 namespace req_handl {
 
 void RequestHandler::ProcessStatRequest (const json::Node& stat_request) const {
     using namespace std::literals;
     
-    json::Array result;
+    std::vector<StatRequest> requests;
+    requests.reserve (stat_request.AsArray().size());
     
     for (const auto& query : stat_request.AsArray()) {
         StatRequest request;
@@ -20,28 +22,66 @@ void RequestHandler::ProcessStatRequest (const json::Node& stat_request) const {
         }
 
         if (query.AsMap().count("from")) {
-            request.from = query.AsMap().at("from"s).AsString();
+            if (query.AsMap().at("from"s).IsArray()) {
+                for (const auto& stop : query.AsMap().at("from"s).AsArray()) {
+                    request.from_stops.push_back (stop.AsString());
+                }
+            } else {
+                request.from = query.AsMap().at("from"s).AsString();
+            }
         }
 
         if (query.AsMap().count("to"s)) {
-            request.to = query.AsMap().at("to"s).AsString();
+            if (query.AsMap().at("to"s).IsArray()) {
+                for (const auto& stop : query.AsMap().at("to"s).AsArray()) {
+                    request.to_stops.push_back (stop.AsString());
+                }
+            } else {
+                request.to = query.AsMap().at("to"s).AsString();
+            }
         }
-        
+
+        if (query.AsMap().count("max_time"s)) {
+            request.max_time = query.AsMap().at("max_time"s).AsDouble();
+        }
+
+        requests.push_back (std::move (request));
+    }
+
+    const auto routes = PlanRoutes (requests);
+
+    // Ответы печатаются по мере готовности, без сборки общего json::Array
+    json::ArrayWriter answers (json::PrintContext{std::cout});
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const StatRequest& request = requests[i];
+
         switch (request.type) {
             case json_reader::RequestType::Stop : {
-                result.push_back(PrintStop (request));
+                json::PrintNode (PrintStop (request), answers.NextItem ());
                 break;
             }
             case json_reader::RequestType::Bus : {
-                result.push_back(PrintBus (request));
+                json::PrintNode (PrintBus (request), answers.NextItem ());
                 break;
             }
             case json_reader::RequestType::Map : {
-                result.push_back(PrintMap (request));
+                json::PrintNode (PrintMap (request), answers.NextItem ());
                 break;
             }
             case json_reader::RequestType::Route : {
-                result.push_back(PrintRoute (request));
+                json::PrintNode (PrintRoute (request, routes[i]), answers.NextItem ());
+                break;
+            }
+            case json_reader::RequestType::Matrix : {
+                json::PrintNode (PrintMatrix (request), answers.NextItem ());
+                break;
+            }
+            case json_reader::RequestType::Isochrone : {
+                PrintIsochrone (request, answers.NextItem ());
+                break;
+            }
+            case json_reader::RequestType::RouterStats : {
+                json::PrintNode (PrintRouterStats (request), answers.NextItem ());
                 break;
             }
             case json_reader::RequestType::Unknown : {
@@ -49,22 +89,56 @@ void RequestHandler::ProcessStatRequest (const json::Node& stat_request) const {
             }
         }
     }
-    json::Print (json::Document{result}, std::cout);
+    answers.Close ();
+}
+
+// Запросы Route группируются по from: на группу выполняется один поиск из одной
+// остановки во все её цели, ответы раскладываются по индексам исходных запросов
+std::vector<std::optional<transport_router::TransportRouter::RouteItems>> RequestHandler::PlanRoutes (const std::vector<StatRequest>& requests) const {
+    struct RouteGroup {
+        std::string_view from;
+        std::vector<size_t> request_indexes;
+        std::vector<std::string_view> to_stop_names;
+    };
+
+    std::vector<RouteGroup> groups;
+    std::unordered_map<std::string_view, size_t> group_by_from;
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (requests[i].type != json_reader::RequestType::Route) {
+            continue;
+        }
+        auto [it, inserted] = group_by_from.emplace (requests[i].from, groups.size());
+        if (inserted) {
+            groups.push_back ({requests[i].from, {}, {}});
+        }
+        groups[it -> second].request_indexes.push_back (i);
+        groups[it -> second].to_stop_names.push_back (requests[i].to);
+    }
+
+    std::vector<std::optional<transport_router::TransportRouter::RouteItems>> routes (requests.size());
+    for (const auto& group : groups) {
+        auto group_routes = router_.GetRoutesFromStop (group.from, group.to_stop_names);
+        for (size_t i = 0; i < group_routes.size(); ++i) {
+            routes[group.request_indexes[i]] = std::move (group_routes[i]);
+        }
+    }
+    return routes;
 }
 
 svg::Document RequestHandler::MapRender () const {
-    return map_renderer_.GetMapRender (catalogue_.GetBusDirectory ());
+    return map_renderer_.GetMapRender (catalogue_.GetBusesByName (), catalogue_.GetStops ());
 }
 
 json::Node RequestHandler::PrintStop (const StatRequest& request) const {
     using namespace std::literals;
     json::Node result;
 
-    if (catalogue_.GetStopByName (request.name) != nullptr) {
+    if (const domain::Stop* stop = catalogue_.GetStopByName (request.name)) {
         json::Array buses;
 
-        for (const auto& bus_name : catalogue_.GetStopPropertyByName (request.name)) {
-            buses.push_back(json::Node(bus_name));
+        for (const domain::BusId bus_id : catalogue_.GetBusIdsForStop (stop->stop_id)) {
+            buses.push_back(json::Node(catalogue_.GetBusById (bus_id)->bus_name));
         }
 
         result = json::Builder {}
@@ -128,11 +202,10 @@ json::Node RequestHandler::PrintMap (const StatRequest& request) const {
     .Build ();
 }
 
-json::Node RequestHandler::PrintRoute (const StatRequest& request) const {
+json::Node RequestHandler::PrintRoute (const StatRequest& request, const std::optional<transport_router::TransportRouter::RouteItems>& route) const {
     using namespace std::literals;
 
     json::Node result;
-    const auto route = router_.GetRouteBetweenStops (request.from, request.to);
     
     if (route.has_value()) {
         json::Array items;
@@ -150,10 +223,10 @@ json::Node RequestHandler::PrintRoute (const StatRequest& request) const {
         }
 
         for (auto& item : route.value().items) {
-            if (item.type == "Wait"s){
+            if (item.type == transport_router::ItemType::Wait){
                 items.push_back(json::Node(json::Builder{}
                     .StartDict()
-                        .Key ("stop_name"s).Value (item.name)
+                        .Key ("stop_name"s).Value (std::string (item.name))
                         .Key ("time"s).Value (item.time)
                         .Key ("type"s).Value ("Wait"s)
                     .EndDict()
@@ -162,7 +235,7 @@ json::Node RequestHandler::PrintRoute (const StatRequest& request) const {
             } else {
                 items.push_back(json::Node(json::Builder{}
                     .StartDict()
-                        .Key ("bus"s).Value (item.name)
+                        .Key ("bus"s).Value (std::string (item.name))
                         .Key ("span_count").Value (item.span_count)
                         .Key ("time"s).Value (item.time)
                         .Key ("type"s).Value ("Bus"s)
@@ -190,4 +263,124 @@ json::Node RequestHandler::PrintRoute (const StatRequest& request) const {
     return result;
 } 
 
+// Времена в пути матрицей from x to, null — маршрута нет
+json::Node RequestHandler::PrintMatrix (const StatRequest& request) const {
+    using namespace std::literals;
+
+    std::vector<std::string_view> from_stops (request.from_stops.begin(), request.from_stops.end());
+    std::vector<std::string_view> to_stops (request.to_stops.begin(), request.to_stops.end());
+
+    for (const auto* stops : {&from_stops, &to_stops}) {
+        for (std::string_view stop_name : *stops) {
+            if (catalogue_.GetStopByName (stop_name) == nullptr) {
+                return json::Builder{}
+                    .StartDict()
+                        .Key ("request_id"s).Value (request.id)
+                        .Key ("error_message"s).Value ("not found"s)
+                    .EndDict ()
+                .Build ();
+            }
+        }
+    }
+
+    json::Array times;
+    times.reserve (from_stops.size());
+    for (const auto& row : router_.GetTimeMatrix (from_stops, to_stops)) {
+        json::Array row_times;
+        row_times.reserve (row.size());
+        for (const auto& time : row) {
+            row_times.push_back (time.has_value() ? json::Node(time.value()) : json::Node(nullptr));
+        }
+        times.push_back (std::move (row_times));
+    }
+
+    return json::Builder{}
+        .StartDict()
+            .Key ("request_id"s).Value (request.id)
+            .Key ("times"s).Value (std::move (times))
+        .EndDict ()
+    .Build ();
+}
+
+// Остановки, достижимые из name за max_time минут, с временем прибытия. Остановки
+// печатаются прямо из обхода: ответ на большой бюджет не собирается в json::Array
+void RequestHandler::PrintIsochrone (const StatRequest& request, const json::PrintContext& ctx) const {
+    using namespace std::literals;
+
+    if (catalogue_.GetStopByName (request.name) == nullptr) {
+        json::PrintNode (json::Builder{}
+            .StartDict()
+                .Key ("request_id"s).Value (request.id)
+                .Key ("error_message"s).Value ("not found"s)
+            .EndDict ()
+        .Build (), ctx);
+        return;
+    }
+
+    json::DictWriter answer (ctx);
+    json::PrintNode (request.id, answer.Key ("request_id"s));
+    json::ArrayWriter stops (answer.Key ("stops"s));
+    router_.ForEachReachableStop (request.name, request.max_time, [&stops](std::string_view stop_name, double time) {
+        json::PrintNode (json::Builder{}
+            .StartDict()
+                .Key ("stop_name"s).Value (std::string (stop_name))
+                .Key ("time"s).Value (time)
+            .EndDict()
+        .Build(), stops.NextItem ());
+    });
+    stops.Close ();
+    answer.Close ();
+}
+
+// Модель графа, его размер и время построения (после загрузки снимка — время построения в make_base),
+// применённые политики размещения массивов графа и таблицы всех пар и отказы страниц
+// за построение или загрузку маршрутизатора. Счётчики поисков включают все запросы Route
+// пакета (они выполняются до ответа на первый запрос) и остальные запросы перед этим.
+// Работа обновлений весов — сумма по всем update_requests
+json::Node RequestHandler::PrintRouterStats (const StatRequest& request) const {
+    using namespace std::literals;
+
+    const transport_router::GraphStats& graph_stats = router_.GetGraphStats ();
+    const transport_router::EngineStats engine_stats = router_.GetEngineStats ();
+    const transport_router::UpdateStats& update_stats = router_.GetUpdateStats ();
+    const size_t cache_lookup_count = engine_stats.cache_hit_count + engine_stats.cache_miss_count;
+    const double cache_hit_rate = cache_lookup_count == 0 ? 0.0 : static_cast<double>(engine_stats.cache_hit_count) / cache_lookup_count;
+    const bool is_line_model = router_.GetSettings ().graph_model == transport_router::GraphModel::Line;
+    const auto print_memory_policy = [](const storage::MemoryPolicy& policy) {
+        return json::Builder{}
+            .StartDict()
+                .Key ("huge_pages"s).Value (json_reader::GetPageSizeName (policy.page_size))
+                .Key ("numa_placement"s).Value (json_reader::GetNumaPlacementName (policy.numa_placement))
+            .EndDict ()
+        .Build ().AsMap ();
+    };
+
+    return json::Builder{}
+        .StartDict()
+            .Key ("request_id"s).Value (request.id)
+            .Key ("graph_model"s).Value (is_line_model ? "line"s : "span"s)
+            .Key ("vertex_count"s).Value (static_cast<int>(graph_stats.vertex_count))
+            .Key ("edge_count"s).Value (static_cast<int>(graph_stats.edge_count))
+            .Key ("build_time_ms"s).Value (graph_stats.build_time_ms)
+            .Key ("graph_memory_policy"s).Value (print_memory_policy (graph_stats.graph_memory_policy))
+            .Key ("table_memory_policy"s).Value (print_memory_policy (graph_stats.table_memory_policy))
+            .Key ("page_fault_count"s).Value (static_cast<int>(graph_stats.page_fault_count))
+            .Key ("query_count"s).Value (static_cast<int>(engine_stats.query_count))
+            .Key ("settled_count"s).Value (static_cast<int>(engine_stats.settled_count))
+            .Key ("shortcut_count"s).Value (static_cast<int>(engine_stats.shortcut_count))
+            .Key ("landmark_count"s).Value (static_cast<int>(engine_stats.landmark_count))
+            .Key ("cache_hit_count"s).Value (static_cast<int>(engine_stats.cache_hit_count))
+            .Key ("cache_miss_count"s).Value (static_cast<int>(engine_stats.cache_miss_count))
+            .Key ("cache_hit_rate"s).Value (cache_hit_rate)
+            .Key ("cache_eviction_count"s).Value (static_cast<int>(engine_stats.cache_eviction_count))
+            .Key ("cache_byte_size"s).Value (static_cast<int>(engine_stats.cache_byte_size))
+            .Key ("update_count"s).Value (static_cast<int>(update_stats.update_count))
+            .Key ("update_changed_edge_count"s).Value (static_cast<int>(update_stats.changed_edge_count))
+            .Key ("update_repaired_count"s).Value (static_cast<int>(update_stats.repaired_count))
+            .Key ("update_settled_count"s).Value (static_cast<int>(update_stats.settled_count))
+            .Key ("update_time_ms"s).Value (update_stats.repair_time_ms)
+        .EndDict ()
+    .Build ();
+}
+
 } // namespace req_handl
\ No newline at end of file
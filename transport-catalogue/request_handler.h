@@ -4,6 +4,10 @@
 #include "json_builder.h"
 #include "json_reader.h"
 
+#include <optional>
+#include <string>
+#include <vector>
+
 namespace req_handl {
 
 struct StatRequest {
@@ -12,6 +16,11 @@ struct StatRequest {
     std::string name;
     std::string from;
     std::string to;
+    // Списки остановок запроса Matrix
+    std::vector<std::string> from_stops;
+    std::vector<std::string> to_stops;
+    // Бюджет времени запроса Isochrone, мин
+    double max_time = 0.0;
 };
 
 class RequestHandler {
@@ -33,7 +42,13 @@ private:
     json::Node PrintStop   (const StatRequest& request) const;
     json::Node PrintBus    (const StatRequest& request) const;
     json::Node PrintMap    (const StatRequest& request) const;
-    json::Node PrintRoute  (const StatRequest& request) const;
+    json::Node PrintRoute  (const StatRequest& request, const std::optional<transport_router::TransportRouter::RouteItems>& route) const;
+    json::Node PrintMatrix (const StatRequest& request) const;
+    void PrintIsochrone (const StatRequest& request, const json::PrintContext& ctx) const;
+    json::Node PrintRouterStats (const StatRequest& request) const;
+
+    // Ответы на все запросы Route пакетно, по индексам requests
+    std::vector<std::optional<transport_router::TransportRouter::RouteItems>> PlanRoutes (const std::vector<StatRequest>& requests) const;
 };
 
 } // namespace req_handl
@@ -1,90 +1,262 @@
 #pragma once
 
+#include "csr_graph.h"
 #include "graph.h"
+#include "min_plus.h"
+#include "router_engine.h"
+#include "routes_table.h"
+#include "thread_pool.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
+#include <queue>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
-template <typename Weight>
-class Router {
+// StoredWeight — тип весов в таблице. Router<double, float> хранит таблицу
+// во float (вдвое меньше памяти), а вес маршрута пересчитывает по рёбрам графа.
+template <typename Weight, typename StoredWeight = Weight>
+class Router : public RouterEngine<Weight> {
 private:
-    using Graph = DirectedWeightedGraph<Weight>;
+    using Graph = CsrGraph<Weight>;
 
 public:
-    explicit Router(const Graph& graph);
+    using Table = RoutesTable<StoredWeight>;
+    using RouteInfo = typename RouterEngine<Weight>::RouteInfo;
+    using EdgeWeightChange = typename RouterEngine<Weight>::EdgeWeightChange;
+    using RepairStats = typename RouterEngine<Weight>::RepairStats;
 
-    struct RouteInfo {
-        Weight weight;
-        std::vector<EdgeId> edges;
-    };
+    // Таблица в памяти, размещённой по memory_policy (огромные страницы, узлы NUMA)
+    explicit Router(const Graph& graph, const storage::MemoryPolicy& memory_policy = {});
+
+    // Блочный (tiled) Флойд–Уоршелл: независимые блоки каждой фазы
+    // обрабатываются пулом из thread_count потоков (0 — по числу ядер)
+    Router(const Graph& graph, size_t thread_count, const storage::MemoryPolicy& memory_policy = {});
+
+    // Таблица во внешней памяти: строки считаются алгоритмом Дейкстры из каждой
+    // вершины (thread_count потоков) и пишутся в отображённый файл table_path.
+    // Запрос читает только строку from, остальное вытесняет страничный кэш
+    Router(const Graph& graph, const std::string& table_path, size_t thread_count);
+
+    // Готовая таблица, например загруженная из снимка
+    Router(const Graph& graph, Table routes_table);
+
+    const Table& GetRoutesTable() const {
+        return routes_internal_data_;
+    }
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Веса читаются прямо из таблицы, без восстановления маршрутов
+    std::vector<std::vector<std::optional<Weight>>> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                                      const std::vector<VertexId>& targets) const override;
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    // Пересчитываются только строки, дерево которых меняется: оно содержит
+    // подорожавшее или подешевевшее ребро либо подешевевшее ребро его улучшает
+    RepairStats RepairAfterWeightChanges(const std::vector<EdgeWeightChange>& changes) override;
 
 private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
+    // Рабочие массивы Дейкстры по строкам, сбрасываются по списку достигнутых вершин
+    struct RowWorkspace {
+        std::priority_queue<std::pair<Weight, VertexId>, std::vector<std::pair<Weight, VertexId>>,
+                            std::greater<std::pair<Weight, VertexId>>> queue;
+        std::vector<Weight> weights;
+        std::vector<VertexId> reached;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
     void InitializeRoutesInternalData(const Graph& graph) {
+        if (graph.GetEdgeCount() >= Table::NO_EDGE) {
+            throw std::length_error("Too many edges for the routes table");
+        }
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
+            StoredWeight* weights = routes_internal_data_.GetWeights(vertex);
+            CompactEdgeId* prev_edges = routes_internal_data_.GetPrevEdges(vertex);
+            weights[vertex] = ZERO_WEIGHT;
+            for (size_t arc = graph.GetArcBegin(vertex); arc < graph.GetArcEnd(vertex); ++arc) {
+                if (graph.GetArcWeight(arc) < Weight{}) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const VertexId target = graph.GetArcTarget(arc);
+                const auto edge_weight = static_cast<StoredWeight>(graph.GetArcWeight(arc));
+                if (weights[target] > edge_weight) {
+                    weights[target] = edge_weight;
+                    prev_edges[target] = static_cast<CompactEdgeId>(graph.GetArcEdgeId(arc));
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    // Релаксация отрезка [column_begin, column_end) строки vertex_from через vertex_through
+    void RelaxRow(VertexId vertex_from, VertexId vertex_through, VertexId column_begin, VertexId column_end) {
+        StoredWeight* weights_from = routes_internal_data_.GetWeights(vertex_from);
+        CompactEdgeId* prev_edges_from = routes_internal_data_.GetPrevEdges(vertex_from);
+        const StoredWeight weight_through = weights_from[vertex_through];
+        if (weight_through == Table::NO_ROUTE) {
+            return;
+        }
+        const CompactEdgeId prev_edge_through = prev_edges_from[vertex_through];
+        const StoredWeight* weights_to = routes_internal_data_.GetWeights(vertex_through);
+        const CompactEdgeId* prev_edges_to = routes_internal_data_.GetPrevEdges(vertex_through);
+        const size_t count = column_end - column_begin;
+
+        if constexpr (std::is_same_v<StoredWeight, double> || std::is_same_v<StoredWeight, float>) {
+            min_plus::RelaxRow(weights_from + column_begin, prev_edges_from + column_begin,
+                               weight_through, prev_edge_through,
+                               weights_to + column_begin, prev_edges_to + column_begin, count);
+        } else {
+            min_plus::RelaxRowScalar(weights_from + column_begin, prev_edges_from + column_begin,
+                                     weight_through, prev_edge_through,
+                                     weights_to + column_begin, prev_edges_to + column_begin, count);
         }
     }
 
     void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
         for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+            RelaxRow(vertex_from, vertex_through, 0, vertex_count);
+        }
+    }
+
+    // Релаксация блока [row_tile] x [column_tile] через вершины блока through_tile
+    void RelaxTile(size_t vertex_count, size_t row_tile, size_t column_tile, size_t through_tile) {
+        const VertexId row_end = std::min(vertex_count, (row_tile + 1) * TILE_SIZE);
+        const VertexId column_end = std::min(vertex_count, (column_tile + 1) * TILE_SIZE);
+        const VertexId through_end = std::min(vertex_count, (through_tile + 1) * TILE_SIZE);
+
+        for (VertexId vertex_through = through_tile * TILE_SIZE; vertex_through < through_end; ++vertex_through) {
+            for (VertexId vertex_from = row_tile * TILE_SIZE; vertex_from < row_end; ++vertex_from) {
+                RelaxRow(vertex_from, vertex_through, column_tile * TILE_SIZE, column_end);
+            }
+        }
+    }
+
+    void RelaxRoutesInternalDataByTiles(size_t vertex_count, parallel::ThreadPool& pool) {
+        const size_t tile_count = (vertex_count + TILE_SIZE - 1) / TILE_SIZE;
+
+        for (size_t through_tile = 0; through_tile < tile_count; ++through_tile) {
+            // Фаза 1: диагональный блок зависит только от себя
+            RelaxTile(vertex_count, through_tile, through_tile, through_tile);
+
+            // Фаза 2: блоки строки и столбца through_tile зависят от диагонального
+            pool.ParallelFor(2 * tile_count, [&](size_t task) {
+                const size_t tile = task % tile_count;
+                if (tile == through_tile) {
+                    return;
+                }
+                if (task < tile_count) {
+                    RelaxTile(vertex_count, through_tile, tile, through_tile);
+                } else {
+                    RelaxTile(vertex_count, tile, through_tile, through_tile);
+                }
+            });
+
+            // Фаза 3: остальные блоки зависят от блоков строки и столбца
+            pool.ParallelFor(tile_count * tile_count, [&](size_t task) {
+                const size_t row_tile = task / tile_count;
+                const size_t column_tile = task % tile_count;
+                if (row_tile == through_tile || column_tile == through_tile) {
+                    return;
+                }
+                RelaxTile(vertex_count, row_tile, column_tile, through_tile);
+            });
+        }
+    }
+
+    static void CheckEdgeWeights(const Graph& graph) {
+        if (graph.GetEdgeCount() >= Table::NO_EDGE) {
+            throw std::length_error("Too many edges for the routes table");
+        }
+        for (size_t arc = 0; arc < graph.GetEdgeCount(); ++arc) {
+            if (graph.GetArcWeight(arc) < Weight{}) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    // Строка from — дерево кратчайших путей Дейкстры из from; возвращает число обработанных вершин
+    size_t FillRow(VertexId from, RowWorkspace& workspace) {
+        const size_t vertex_count = graph_.GetVertexCount();
+        auto& weights = workspace.weights;
+        if (weights.size() != vertex_count) {
+            weights.assign(vertex_count, std::numeric_limits<Weight>::max());
+        }
+
+        routes_internal_data_.ClearRow(from);
+        StoredWeight* row_weights = routes_internal_data_.GetWeights(from);
+        CompactEdgeId* row_prev_edges = routes_internal_data_.GetPrevEdges(from);
+
+        size_t settled_count = 0;
+        weights[from] = Weight{};
+        workspace.reached.push_back(from);
+        workspace.queue.push({Weight{}, from});
+        while (!workspace.queue.empty()) {
+            const auto [weight, vertex] = workspace.queue.top();
+            workspace.queue.pop();
+            if (weights[vertex] < weight) {
+                continue;
+            }
+            ++settled_count;
+            row_weights[vertex] = static_cast<StoredWeight>(weight);
+            for (size_t arc = graph_.GetArcBegin(vertex); arc < graph_.GetArcEnd(vertex); ++arc) {
+                const VertexId target = graph_.GetArcTarget(arc);
+                const Weight candidate_weight = weight + graph_.GetArcWeight(arc);
+                if (candidate_weight < weights[target]) {
+                    if (weights[target] == std::numeric_limits<Weight>::max()) {
+                        workspace.reached.push_back(target);
                     }
+                    weights[target] = candidate_weight;
+                    row_prev_edges[target] = static_cast<CompactEdgeId>(graph_.GetArcEdgeId(arc));
+                    workspace.queue.push({candidate_weight, target});
                 }
             }
         }
+
+        for (const VertexId vertex : workspace.reached) {
+            weights[vertex] = std::numeric_limits<Weight>::max();
+        }
+        workspace.reached.clear();
+        return settled_count;
     }
 
-    static constexpr Weight ZERO_WEIGHT{};
+    // Строки таблицы независимы: строка from — дерево кратчайших путей из from.
+    // Задача пула — блок из TILE_SIZE подряд идущих строк, поэтому файл заполняется
+    // почти последовательно, а Флойд–Уоршелл не гоняет всю таблицу через память V раз
+    void FillRowsByDijkstra(parallel::ThreadPool& pool) {
+        const size_t vertex_count = graph_.GetVertexCount();
+        const size_t tile_count = (vertex_count + TILE_SIZE - 1) / TILE_SIZE;
+        pool.ParallelFor(tile_count, [&](size_t tile) {
+            RowWorkspace workspace;
+            const VertexId row_end = std::min(vertex_count, (tile + 1) * TILE_SIZE);
+            for (VertexId from = tile * TILE_SIZE; from < row_end; ++from) {
+                FillRow(from, workspace);
+            }
+        });
+    }
+
+    static constexpr StoredWeight ZERO_WEIGHT{};
+    static constexpr size_t TILE_SIZE = 64;
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    Table routes_internal_data_;
+    // Потоки пересчёта строк при починке таблицы
+    size_t thread_count_ = 1;
 };
 
-template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+template <typename Weight, typename StoredWeight>
+Router<Weight, StoredWeight>::Router(const Graph& graph, const storage::MemoryPolicy& memory_policy)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , routes_internal_data_(graph.GetVertexCount(), memory_policy)
 {
     InitializeRoutesInternalData(graph);
 
@@ -94,24 +266,144 @@ Router<Weight>::Router(const Graph& graph)
     }
 }
 
-template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-                                                                             VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+template <typename Weight, typename StoredWeight>
+Router<Weight, StoredWeight>::Router(const Graph& graph, size_t thread_count,
+                                     const storage::MemoryPolicy& memory_policy)
+    : graph_(graph)
+    , routes_internal_data_(graph.GetVertexCount(), memory_policy)
+    , thread_count_(thread_count)
+{
+    InitializeRoutesInternalData(graph);
+
+    parallel::ThreadPool pool(thread_count);
+    RelaxRoutesInternalDataByTiles(graph.GetVertexCount(), pool);
+}
+
+template <typename Weight, typename StoredWeight>
+Router<Weight, StoredWeight>::Router(const Graph& graph, const std::string& table_path, size_t thread_count)
+    : graph_(graph)
+    , routes_internal_data_(Table::CreateMapped(graph.GetVertexCount(), table_path))
+    , thread_count_(thread_count)
+{
+    CheckEdgeWeights(graph);
+    parallel::ThreadPool pool(thread_count);
+    FillRowsByDijkstra(pool);
+}
+
+template <typename Weight, typename StoredWeight>
+Router<Weight, StoredWeight>::Router(const Graph& graph, Table routes_table)
+    : graph_(graph)
+    , routes_internal_data_(std::move(routes_table))
+{
+    if (routes_internal_data_.GetVertexCount() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Routes table does not match the graph");
+    }
+}
+
+template <typename Weight, typename StoredWeight>
+std::optional<typename Router<Weight, StoredWeight>::RouteInfo> Router<Weight, StoredWeight>::BuildRoute(
+    VertexId from, VertexId to) const {
+    if (from >= routes_internal_data_.GetVertexCount() || to >= routes_internal_data_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const StoredWeight* weights = routes_internal_data_.GetWeights(from);
+    const CompactEdgeId* prev_edges = routes_internal_data_.GetPrevEdges(from);
+    if (weights[to] == Table::NO_ROUTE) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
+    Weight weight{};
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (CompactEdgeId edge_id = prev_edges[to];
+         edge_id != Table::NO_EDGE;
+         edge_id = prev_edges[graph_.GetEdge(edge_id).from])
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
+    if constexpr (std::is_same_v<Weight, StoredWeight>) {
+        weight = weights[to];
+    } else {
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+    }
+
     return RouteInfo{weight, std::move(edges)};
 }
 
+template <typename Weight, typename StoredWeight>
+typename Router<Weight, StoredWeight>::RepairStats Router<Weight, StoredWeight>::RepairAfterWeightChanges(
+    const std::vector<EdgeWeightChange>& changes) {
+    CheckEdgeWeights(graph_);
+
+    // Если дерево строки не содержит ребро и ребро его не улучшает, веса и
+    // последние рёбра строки остаются кратчайшими: дороже стали только пути вне дерева
+    const size_t vertex_count = routes_internal_data_.GetVertexCount();
+    std::vector<VertexId> affected_rows;
+    for (VertexId from = 0; from < vertex_count; ++from) {
+        const StoredWeight* weights = routes_internal_data_.GetWeights(from);
+        const CompactEdgeId* prev_edges = routes_internal_data_.GetPrevEdges(from);
+        const bool affected = std::any_of(changes.begin(), changes.end(), [&](const EdgeWeightChange& change) {
+            const auto& edge = graph_.GetEdge(change.edge);
+            if (prev_edges[edge.to] == change.edge) {
+                return true;
+            }
+            return edge.weight < change.old_weight && weights[edge.from] != Table::NO_ROUTE
+                && static_cast<StoredWeight>(weights[edge.from] + edge.weight) < weights[edge.to];
+        });
+        if (affected) {
+            affected_rows.push_back(from);
+        }
+    }
+
+    std::atomic<size_t> settled_count = 0;
+    parallel::ThreadPool pool(thread_count_);
+    pool.ParallelFor((affected_rows.size() + TILE_SIZE - 1) / TILE_SIZE, [&](size_t tile) {
+        RowWorkspace workspace;
+        size_t tile_settled_count = 0;
+        const size_t row_end = std::min(affected_rows.size(), (tile + 1) * TILE_SIZE);
+        for (size_t i = tile * TILE_SIZE; i < row_end; ++i) {
+            tile_settled_count += FillRow(affected_rows[i], workspace);
+        }
+        settled_count += tile_settled_count;
+    });
+
+    RepairStats stats;
+    stats.repaired_count = affected_rows.size();
+    stats.settled_count = settled_count;
+    return stats;
+}
+
+template <typename Weight, typename StoredWeight>
+std::vector<std::vector<std::optional<Weight>>> Router<Weight, StoredWeight>::BuildWeightMatrix(
+    const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+    // Во float-таблице веса приближённые, точный вес даёт только сумма по рёбрам маршрута
+    if constexpr (!std::is_same_v<Weight, StoredWeight>) {
+        return RouterEngine<Weight>::BuildWeightMatrix(sources, targets);
+    } else {
+        const size_t vertex_count = routes_internal_data_.GetVertexCount();
+        for (const VertexId to : targets) {
+            if (to >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+        }
+
+        std::vector<std::vector<std::optional<Weight>>> matrix;
+        matrix.reserve(sources.size());
+        for (const VertexId from : sources) {
+            if (from >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            const StoredWeight* weights = routes_internal_data_.GetWeights(from);
+            auto& row = matrix.emplace_back();
+            row.reserve(targets.size());
+            for (const VertexId to : targets) {
+                row.push_back(weights[to] == Table::NO_ROUTE ? std::nullopt : std::optional<Weight>(weights[to]));
+            }
+        }
+        return matrix;
+    }
+}
+
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,168 @@
+// Замеры маршрутизатора на базе из JSON (base_requests и routing_settings, как у transport-catalogue):
+//   router-bench <input.json> [all|floyd|min_plus|vertex_order] [query_count]
+// Сравниваются классический и блочный Флойд—Уоршелл, скалярное и AVX2 min-plus
+// обновление строки, нумерация вершин в порядке каталога и по кривой Гильберта
+
+#include "json_reader.h"
+#include "min_plus.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace transport_router;
+
+double GetElapsedMs (std::chrono::steady_clock::time_point start_time) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// Время предрасчёта движка: построение маршрутизатора без построения графа
+double MeasurePrecomputeMs (const trans_cat::TransportCatalogue& catalogue, const RouteSettings& settings) {
+    const auto start_time = std::chrono::steady_clock::now();
+    TransportRouter router (catalogue, settings);
+    return GetElapsedMs (start_time) - router.GetGraphStats ().build_time_ms;
+}
+
+void BenchFloydWarshall (const trans_cat::TransportCatalogue& catalogue, RouteSettings settings) {
+    std::cout << "all-pairs precompute, ms\n";
+
+    settings.router_type = RouterType::AllPairs;
+    const double classic_ms = MeasurePrecomputeMs (catalogue, settings);
+    std::cout << "  classic:            " << classic_ms << '\n';
+
+    settings.router_type = RouterType::AllPairsTiled;
+    for (const size_t thread_count : {size_t{1}, size_t{0}}) {
+        settings.thread_count = thread_count;
+        const double tiled_ms = MeasurePrecomputeMs (catalogue, settings);
+        std::cout << "  tiled, " << (thread_count == 0 ? "all threads" : "1 thread   ") << ": " << tiled_ms
+                  << " (x" << classic_ms / tiled_ms << ")\n";
+    }
+}
+
+template <typename StoredWeight>
+void BenchMinPlusRow (std::string_view weight_name, size_t row_size) {
+    constexpr size_t REPEAT_COUNT = 20000;
+
+    std::mt19937 generator (1);
+    std::uniform_real_distribution<StoredWeight> distribution (1, 1000);
+    std::vector<StoredWeight> weights_from (row_size);
+    std::vector<StoredWeight> weights_to (row_size);
+    std::vector<graph::CompactEdgeId> prev_edges_from (row_size);
+    std::vector<graph::CompactEdgeId> prev_edges_to (row_size);
+    for (size_t i = 0; i < row_size; ++i) {
+        weights_from[i] = distribution (generator);
+        weights_to[i] = distribution (generator);
+        prev_edges_from[i] = static_cast<graph::CompactEdgeId>(i);
+        prev_edges_to[i] = static_cast<graph::CompactEdgeId>(i + row_size);
+    }
+    auto vector_weights_from = weights_from;
+    auto vector_prev_edges_from = prev_edges_from;
+
+    auto start_time = std::chrono::steady_clock::now();
+    for (size_t repeat = 0; repeat < REPEAT_COUNT; ++repeat) {
+        graph::min_plus::RelaxRowScalar (weights_from.data(), prev_edges_from.data(), static_cast<StoredWeight>(repeat % 7), 7u,
+                                         weights_to.data(), prev_edges_to.data(), row_size);
+    }
+    const double scalar_ms = GetElapsedMs (start_time);
+
+    start_time = std::chrono::steady_clock::now();
+    for (size_t repeat = 0; repeat < REPEAT_COUNT; ++repeat) {
+        graph::min_plus::RelaxRow (vector_weights_from.data(), vector_prev_edges_from.data(), static_cast<StoredWeight>(repeat % 7), 7u,
+                                   weights_to.data(), prev_edges_to.data(), row_size);
+    }
+    const double vector_ms = GetElapsedMs (start_time);
+
+    const double element_count = static_cast<double>(row_size * REPEAT_COUNT);
+    std::cout << "  " << weight_name << ", row " << row_size << ": scalar " << scalar_ms * 1e6 / element_count
+              << " ns/elem, dispatched " << vector_ms * 1e6 / element_count << " ns/elem (x" << scalar_ms / vector_ms << ")"
+              << (weights_from == vector_weights_from && prev_edges_from == vector_prev_edges_from ? "" : " RESULTS DIFFER") << '\n';
+}
+
+void BenchMinPlus () {
+    std::cout << "min-plus row relaxation (AVX2 " << (graph::min_plus::HasAvx2 () ? "available" : "not available") << ")\n";
+    for (const size_t row_size : {size_t{512}, size_t{4096}}) {
+        BenchMinPlusRow<double>("double", row_size);
+        BenchMinPlusRow<float>("float ", row_size);
+    }
+}
+
+void BenchVertexOrder (const trans_cat::TransportCatalogue& catalogue, RouteSettings settings, size_t query_count) {
+    std::vector<std::string_view> stop_names;
+    for (const auto& stop : catalogue.GetStops ()) {
+        stop_names.push_back (stop.stop_name);
+    }
+    std::sort (stop_names.begin(), stop_names.end());
+
+    std::cout << "route queries by vertex order, us/query\n";
+    for (const RouterType router_type : {RouterType::Dijkstra, RouterType::AStar}) {
+        settings.router_type = router_type;
+        double directory_us = 0.0;
+        for (const VertexOrder vertex_order : {VertexOrder::Directory, VertexOrder::Hilbert}) {
+            settings.vertex_order = vertex_order;
+            const TransportRouter router (catalogue, settings);
+
+            // Одни и те же пары остановок для обеих нумераций
+            std::mt19937 generator (5);
+            double total_time = 0.0;
+            const auto start_time = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < query_count; ++i) {
+                const std::string_view from = stop_names[generator () % stop_names.size()];
+                const std::string_view to = stop_names[generator () % stop_names.size()];
+                if (const auto route = router.GetRouteBetweenStops (from, to)) {
+                    total_time += route->total_time;
+                }
+            }
+            const double query_us = GetElapsedMs (start_time) * 1000.0 / static_cast<double>(query_count);
+
+            std::cout << "  " << (router_type == RouterType::Dijkstra ? "dijkstra" : "astar   ") << ", "
+                      << (vertex_order == VertexOrder::Directory ? "directory: " : "hilbert:   ") << query_us;
+            if (vertex_order == VertexOrder::Directory) {
+                directory_us = query_us;
+            } else {
+                std::cout << " (x" << directory_us / query_us << ")";
+            }
+            std::cout << ", total time " << total_time << '\n';
+        }
+    }
+}
+
+} // namespace
+
+int main (int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: router-bench <input.json> [all|floyd|min_plus|vertex_order] [query_count]\n";
+        return 1;
+    }
+    std::ifstream input (argv[1]);
+    if (!input) {
+        std::cerr << "Cannot open " << argv[1] << '\n';
+        return 1;
+    }
+    const std::string section = argc > 2 ? argv[2] : "all";
+    const size_t query_count = argc > 3 ? std::stoul (argv[3]) : 2000;
+
+    trans_cat::TransportCatalogue catalogue;
+    json_reader::JsonReader reader (input);
+    reader.ProcessBaseRequest (catalogue);
+    const RouteSettings settings = reader.ProcessRouterSetting (reader.GetRouteSettings ().AsMap ());
+    std::cout << "stops: " << catalogue.GetStops ().size() << ", buses: " << catalogue.GetBuses ().size() << '\n';
+
+    if (section == "all" || section == "floyd") {
+        BenchFloydWarshall (catalogue, settings);
+    }
+    if (section == "all" || section == "min_plus") {
+        BenchMinPlus ();
+    }
+    if (section == "all" || section == "vertex_order") {
+        BenchVertexOrder (catalogue, settings, query_count);
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "graph.h"
+
+#include <optional>
+#include <vector>
+
+namespace graph {
+
+// Общий интерфейс движков маршрутизации: таблица всех пар (Router),
+// поиск по запросу (DijkstraRouter) и т.д.
+template <typename Weight>
+class RouterEngine {
+public:
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    // Счётчики поисков по запросу: сколько вершин пришлось окончательно обработать
+    // и, при кэше деревьев кратчайших путей, сколько запросов он обслужил
+    struct SearchStats {
+        size_t query_count = 0;
+        size_t settled_count = 0;
+        size_t cache_hit_count = 0;
+        size_t cache_miss_count = 0;
+    };
+
+    // Изменение веса ребра: новый вес уже записан в граф, old_weight — прежний
+    struct EdgeWeightChange {
+        EdgeId edge;
+        Weight old_weight;
+    };
+
+    // Объём починки предрасчёта после изменения весов: сколько его частей
+    // пересчитано (строк таблицы, сжатых вершин) и сколько вершин обработали поиски
+    struct RepairStats {
+        size_t repaired_count = 0;
+        size_t settled_count = 0;
+    };
+
+    virtual ~RouterEngine() = default;
+
+    virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+    // Маршруты из from во все targets (ответы в порядке targets). По умолчанию —
+    // отдельный BuildRoute на каждую цель; движки с поиском по запросу
+    // переопределяют его одним поиском на всю группу.
+    virtual std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+        std::vector<std::optional<RouteInfo>> routes;
+        routes.reserve(targets.size());
+        for (const VertexId to : targets) {
+            routes.push_back(BuildRoute(from, to));
+        }
+        return routes;
+    }
+
+    // Матрица весов маршрутов sources x targets, nullopt — маршрута нет.
+    // По умолчанию — BuildRoutes из каждого источника.
+    virtual std::vector<std::vector<std::optional<Weight>>> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                                              const std::vector<VertexId>& targets) const {
+        std::vector<std::vector<std::optional<Weight>>> matrix;
+        matrix.reserve(sources.size());
+        for (const VertexId from : sources) {
+            auto& row = matrix.emplace_back();
+            row.reserve(targets.size());
+            for (const auto& route : BuildRoutes(from, targets)) {
+                row.push_back(route ? std::optional<Weight>(route->weight) : std::nullopt);
+            }
+        }
+        return matrix;
+    }
+
+    // Движки с предрасчётом всех пар поиска не выполняют и возвращают нули
+    virtual SearchStats GetSearchStats() const {
+        return {};
+    }
+
+    // Вызывается после изменения весов рёбер графа, на котором построен движок.
+    // Движку без предрасчёта чинить нечего
+    virtual RepairStats RepairAfterWeightChanges(const std::vector<EdgeWeightChange>& /*changes*/) {
+        return {};
+    }
+};
+
+}  // namespace graph
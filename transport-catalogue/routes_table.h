@@ -0,0 +1,166 @@
+#pragma once
+
+#include "graph.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace graph {
+
+// Таблица маршрутов между всеми парами вершин одним непрерывным блоком.
+// Строка from хранит V весов, за которыми идут V последних рёбер маршрутов,
+// поэтому восстановление пути из from читает только свою строку.
+// Вместо std::optional используются значения-заглушки NO_ROUTE и NO_EDGE.
+template <typename StoredWeight>
+class RoutesTable {
+public:
+    static constexpr StoredWeight NO_ROUTE = std::numeric_limits<StoredWeight>::infinity();
+    static constexpr CompactEdgeId NO_EDGE = std::numeric_limits<CompactEdgeId>::max();
+
+    RoutesTable() = default;
+    // Таблица в анонимной памяти, размещённой по memory_policy
+    explicit RoutesTable(size_t vertex_count, const storage::MemoryPolicy& memory_policy = {});
+
+    RoutesTable(const RoutesTable&) = delete;
+    RoutesTable& operator=(const RoutesTable&) = delete;
+    RoutesTable(RoutesTable&&) = default;
+    RoutesTable& operator=(RoutesTable&&) = default;
+
+    // Таблица в файле path, отображённом в память: её размер ограничен диском,
+    // а не ОЗУ. Строки не заполнены, каждую нужно начать с ClearRow
+    static RoutesTable CreateMapped(size_t vertex_count, const std::string& path);
+
+    // Таблица пишется одним выровненным блоком; при загрузке она ссылается
+    // прямо на отображённый файл снимка, без копирования и разбора. С политикой
+    // memory_policy, отличной от умолчательной, таблица копируется в память по ней:
+    // страницы файла не переложить на огромные страницы и другие узлы NUMA
+    void Save(snapshot::Writer& writer) const;
+    static RoutesTable Load(snapshot::Reader& reader, const storage::MemoryPolicy& memory_policy = {});
+
+    size_t GetVertexCount() const {
+        return vertex_count_;
+    }
+
+    size_t GetByteSize() const {
+        return vertex_count_ * row_size_;
+    }
+
+    // Применённая политика размещения строк
+    const storage::MemoryPolicy& GetMemoryPolicy() const {
+        return memory_policy_;
+    }
+
+    StoredWeight* GetWeights(VertexId from) {
+        return reinterpret_cast<StoredWeight*>(data_ + from * row_size_);
+    }
+    const StoredWeight* GetWeights(VertexId from) const {
+        return reinterpret_cast<const StoredWeight*>(data_ + from * row_size_);
+    }
+
+    CompactEdgeId* GetPrevEdges(VertexId from) {
+        return reinterpret_cast<CompactEdgeId*>(data_ + from * row_size_ + prev_edges_offset_);
+    }
+    const CompactEdgeId* GetPrevEdges(VertexId from) const {
+        return reinterpret_cast<const CompactEdgeId*>(data_ + from * row_size_ + prev_edges_offset_);
+    }
+
+    void ClearRow(VertexId from) {
+        std::fill(GetWeights(from), GetWeights(from) + vertex_count_, NO_ROUTE);
+        std::fill(GetPrevEdges(from), GetPrevEdges(from) + vertex_count_, NO_EDGE);
+    }
+
+private:
+    // Выравнивание строк под векторные загрузки
+    static constexpr size_t ROW_ALIGNMENT = 32;
+
+    size_t vertex_count_ = 0;
+    size_t prev_edges_offset_ = 0;
+    size_t row_size_ = 0;
+    // Строки таблицы: анонимный блок или блок отображённого файла
+    std::byte* data_ = nullptr;
+    std::shared_ptr<void> storage_;
+    storage::MemoryPolicy memory_policy_;
+
+    static size_t AlignUp(size_t size) {
+        return (size + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+    }
+
+    void SetLayout(size_t vertex_count) {
+        vertex_count_ = vertex_count;
+        prev_edges_offset_ = AlignUp(vertex_count * sizeof(StoredWeight));
+        row_size_ = AlignUp(prev_edges_offset_ + vertex_count * sizeof(CompactEdgeId));
+    }
+};
+
+template <typename StoredWeight>
+RoutesTable<StoredWeight>::RoutesTable(size_t vertex_count, const storage::MemoryPolicy& memory_policy) {
+    static_assert(std::numeric_limits<StoredWeight>::has_infinity, "Stored weight must have infinity");
+    SetLayout(vertex_count);
+    auto block = std::make_shared<storage::MappedFile>(storage::MappedFile::Allocate(GetByteSize(), memory_policy));
+    data_ = block->GetData();
+    memory_policy_ = block->GetMemoryPolicy();
+    storage_ = std::move(block);
+
+    for (VertexId from = 0; from < vertex_count_; ++from) {
+        ClearRow(from);
+    }
+}
+
+template <typename StoredWeight>
+RoutesTable<StoredWeight> RoutesTable<StoredWeight>::CreateMapped(size_t vertex_count, const std::string& path) {
+    RoutesTable table;
+    table.SetLayout(vertex_count);
+    auto file = std::make_shared<storage::MappedFile>(storage::MappedFile::Create(path, table.GetByteSize()));
+    // Запрос читает одну строку вразброс, упреждающее чтение соседних строк бесполезно
+    file->AdviseRandomAccess();
+    table.data_ = file->GetData();
+    table.storage_ = std::move(file);
+    return table;
+}
+
+template <typename StoredWeight>
+void RoutesTable<StoredWeight>::Save(snapshot::Writer& writer) const {
+    writer.WriteValue<std::uint64_t>(vertex_count_);
+    writer.WriteValue<std::uint64_t>(GetByteSize());
+    writer.WriteBytes(data_, GetByteSize(), ROW_ALIGNMENT);
+}
+
+template <typename StoredWeight>
+RoutesTable<StoredWeight> RoutesTable<StoredWeight>::Load(snapshot::Reader& reader,
+                                                          const storage::MemoryPolicy& memory_policy) {
+    RoutesTable table;
+    const auto vertex_count = reader.ReadValue<std::uint64_t>();
+    const auto byte_size = reader.ReadValue<std::uint64_t>();
+    std::byte* data = reader.ReadBytes(byte_size, ROW_ALIGNMENT);
+
+    // byte_size уже сверен с файлом; строк не больше байт, поэтому размер строки
+    // не переполняется, а произведение проверяется делением
+    if (vertex_count > byte_size || (vertex_count == 0 && byte_size != 0)) {
+        throw snapshot::FormatError("Routes table size does not match its vertex count");
+    }
+    table.SetLayout(vertex_count);
+    if (vertex_count != 0 && (byte_size / table.row_size_ != vertex_count || byte_size % table.row_size_ != 0)) {
+        throw snapshot::FormatError("Routes table size does not match its vertex count");
+    }
+    if (memory_policy.page_size == storage::PageSize::Default
+        && memory_policy.numa_placement == storage::NumaPlacement::Default) {
+        table.data_ = data;
+        table.storage_ = reader.GetStorage();
+        return table;
+    }
+    auto block = std::make_shared<storage::MappedFile>(storage::MappedFile::Allocate(byte_size, memory_policy));
+    std::copy(data, data + byte_size, block->GetData());
+    table.data_ = block->GetData();
+    table.memory_policy_ = block->GetMemoryPolicy();
+    table.storage_ = std::move(block);
+    return table;
+}
+
+}  // namespace graph
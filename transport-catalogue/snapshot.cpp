@@ -0,0 +1,173 @@
+#include "snapshot.h"
+
+#include <algorithm>
+
+namespace snapshot {
+
+namespace {
+
+constexpr std::uint64_t CHECKSUM_PRIME = 0x9E3779B97F4A7C15ull;
+
+std::uint64_t Mix (std::uint64_t hash, std::uint64_t word) {
+    hash ^= word;
+    hash *= CHECKSUM_PRIME;
+    return hash ^ (hash >> 32);
+}
+
+size_t AlignUp (size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// Данные обрабатываются блоками по 32 байта, по 8 байт на полосу
+constexpr size_t CHECKSUM_BLOCK_SIZE = 32;
+
+class ChecksumState {
+public:
+    // size кратен CHECKSUM_BLOCK_SIZE
+    void AddBlocks (const std::byte* data, size_t size) {
+        for (size_t i = 0; i < size; i += CHECKSUM_BLOCK_SIZE) {
+            for (size_t lane = 0; lane < 4; ++lane) {
+                std::uint64_t word;
+                std::memcpy(&word, data + i + lane * 8, 8);
+                lanes_[lane] = Mix(lanes_[lane], word);
+            }
+        }
+    }
+
+    std::uint64_t Finish (const std::byte* tail, size_t tail_size, size_t total_size) const {
+        std::uint64_t hash = Mix(Mix(Mix(lanes_[0], lanes_[1]), lanes_[2]), lanes_[3]);
+        for (size_t i = 0; i < tail_size; ++i) {
+            hash = Mix(hash, static_cast<std::uint64_t>(tail[i]));
+        }
+        return Mix(hash, total_size);
+    }
+
+private:
+    std::uint64_t lanes_[4] = {1, 2, 3, 4};
+};
+
+} // namespace
+
+std::uint64_t ComputeChecksum (const std::byte* data, size_t size) {
+    ChecksumState state;
+    const size_t blocks_size = size / CHECKSUM_BLOCK_SIZE * CHECKSUM_BLOCK_SIZE;
+    state.AddBlocks(data, blocks_size);
+    return state.Finish(data + blocks_size, size - blocks_size, size);
+}
+
+// --------------------------------- Writer ---------------------------------
+
+Writer::Writer (const std::string& path)
+    : path_(path)
+    , output_(path, std::ios::binary | std::ios::trunc) {
+    if (!output_) {
+        throw std::runtime_error("Cannot open snapshot file for writing: " + path);
+    }
+    const Header header{};
+    output_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void Writer::WriteString (std::string_view value) {
+    WriteValue<std::uint64_t>(value.size());
+    WriteBytes(value.data(), value.size(), 1);
+}
+
+void Writer::WriteBytes (const void* data, size_t size, size_t alignment) {
+    static const char zeros[64] = {};
+    const size_t aligned_size = AlignUp(payload_size_, alignment);
+    for (size_t padding = aligned_size - payload_size_; padding > 0; ) {
+        const size_t chunk = std::min(padding, sizeof(zeros));
+        output_.write(zeros, chunk);
+        padding -= chunk;
+    }
+    output_.write(static_cast<const char*>(data), size);
+    payload_size_ = aligned_size + size;
+}
+
+// Контрольная сумма считается по уже записанному файлу, чтобы не держать
+// копию полезной нагрузки в памяти
+void Writer::Finish () {
+    output_.close();
+    if (!output_) {
+        throw std::runtime_error("Cannot write snapshot file: " + path_);
+    }
+
+    // Файл читается кусками, кратными блоку контрольной суммы
+    constexpr size_t CHUNK_SIZE = CHECKSUM_BLOCK_SIZE << 15;
+    std::vector<std::byte> chunk(CHUNK_SIZE);
+    ChecksumState state;
+    std::ifstream input(path_, std::ios::binary);
+    input.seekg(sizeof(Header));
+
+    size_t remaining = payload_size_;
+    while (remaining >= CHECKSUM_BLOCK_SIZE) {
+        const size_t size = std::min(remaining, CHUNK_SIZE) / CHECKSUM_BLOCK_SIZE * CHECKSUM_BLOCK_SIZE;
+        input.read(reinterpret_cast<char*>(chunk.data()), size);
+        state.AddBlocks(chunk.data(), size);
+        remaining -= size;
+    }
+    input.read(reinterpret_cast<char*>(chunk.data()), remaining);
+    if (!input) {
+        throw std::runtime_error("Cannot read back snapshot file: " + path_);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.header_size = sizeof(Header);
+    header.payload_size = payload_size_;
+    header.checksum = state.Finish(chunk.data(), remaining, payload_size_);
+
+    std::fstream file(path_, std::ios::binary | std::ios::in | std::ios::out);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!file) {
+        throw std::runtime_error("Cannot write snapshot header: " + path_);
+    }
+}
+
+// --------------------------------- Reader ---------------------------------
+
+Reader::Reader (const std::string& path)
+    : file_(std::make_shared<storage::MappedFile>(storage::MappedFile::OpenPrivate(path))) {
+    if (file_->GetSize() < sizeof(Header)) {
+        throw FormatError("Snapshot file is truncated: " + path);
+    }
+    Header header;
+    std::memcpy(&header, file_->GetData(), sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw FormatError("Not a snapshot file: " + path);
+    }
+    if (header.version != FORMAT_VERSION || header.header_size != sizeof(Header)) {
+        throw FormatError("Unsupported snapshot version " + std::to_string(header.version) + ": " + path);
+    }
+    if (header.payload_size != file_->GetSize() - sizeof(Header)) {
+        throw FormatError("Snapshot file is truncated: " + path);
+    }
+
+    payload_ = file_->GetData() + sizeof(Header);
+    payload_size_ = header.payload_size;
+    if (ComputeChecksum(payload_, payload_size_) != header.checksum) {
+        throw FormatError("Snapshot checksum mismatch: " + path);
+    }
+}
+
+std::string_view Reader::ReadString () {
+    const auto size = ReadValue<std::uint64_t>();
+    return {reinterpret_cast<const char*>(ReadBytes(size, 1)), size};
+}
+
+std::byte* Reader::ReadBytes (size_t size, size_t alignment) {
+    const size_t begin = AlignUp(position_, alignment);
+    if (begin > payload_size_ || size > payload_size_ - begin) {
+        throw FormatError("Snapshot payload is shorter than expected");
+    }
+    position_ = begin + size;
+    return payload_ + begin;
+}
+
+std::shared_ptr<void> Reader::GetStorage () const {
+    return file_;
+}
+
+} // namespace snapshot
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace snapshot {
+
+// Бинарный снимок справочника и предрасчитанного маршрутизатора.
+// Файл — заголовок фиксированного размера и полезная нагрузка: значения
+// и массивы подряд, без разметки, в порядке записи. Массивы выравниваются,
+// поэтому при чтении через mmap на них можно ссылаться без копирования.
+// Формат зависит от платформы (порядок байт, размеры типов) и версии.
+inline constexpr char MAGIC[8] = {'T', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+inline constexpr std::uint32_t FORMAT_VERSION = 5;
+
+class FormatError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t payload_size;
+    std::uint64_t checksum;
+    std::byte reserved[32];
+};
+// Полезная нагрузка начинается с границы 64 байт от начала отображения
+static_assert(sizeof(Header) == 64);
+
+// Контрольная сумма полезной нагрузки: 64-битный мультипликативный хеш
+// по четырём независимым полосам, чтобы проверка не была узким местом старта
+std::uint64_t ComputeChecksum (const std::byte* data, size_t size);
+
+class Writer {
+public:
+    explicit Writer (const std::string& path);
+
+    template <typename T>
+    void WriteValue (const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written");
+        WriteBytes(&value, sizeof(T), 1);
+    }
+
+    void WriteString (std::string_view value);
+
+    // Размер и выровненный блок данных, читается Reader::ReadVector / ReadBytes
+    template <typename T>
+    void WriteVector (const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written");
+        WriteValue<std::uint64_t>(values.size());
+        WriteBytes(values.data(), values.size() * sizeof(T), alignof(T));
+    }
+
+    // Дополняет файл нулями до границы alignment и пишет size байт
+    void WriteBytes (const void* data, size_t size, size_t alignment);
+
+    // Дописывает заголовок с размером и контрольной суммой
+    void Finish ();
+
+private:
+    std::string path_;
+    std::ofstream output_;
+    std::uint64_t payload_size_ = 0;
+};
+
+class Reader {
+public:
+    // Отображает файл в память и проверяет заголовок, версию и контрольную сумму.
+    // Отображение приватное: запись в полученные блоки не меняет файл.
+    explicit Reader (const std::string& path);
+
+    template <typename T>
+    T ReadValue () {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read");
+        T value;
+        std::memcpy(&value, ReadBytes(sizeof(T), 1), sizeof(T));
+        return value;
+    }
+
+    std::string_view ReadString ();
+
+    template <typename T>
+    std::vector<T> ReadVector () {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read");
+        const auto size = ReadValue<std::uint64_t>();
+        // Размер прочитан из файла: сверка с остатком до умножения и выделения памяти
+        if (size > (payload_size_ - position_) / sizeof(T)) {
+            throw FormatError("Snapshot payload is shorter than expected");
+        }
+        const std::byte* data = ReadBytes(size * sizeof(T), alignof(T));
+        std::vector<T> values(size);
+        std::memcpy(values.data(), data, size * sizeof(T));
+        return values;
+    }
+
+    // Блок внутри отображения; живёт, пока жив GetStorage()
+    std::byte* ReadBytes (size_t size, size_t alignment);
+
+    // Владелец отображения для структур, ссылающихся на блоки без копирования
+    std::shared_ptr<void> GetStorage () const;
+
+private:
+    std::shared_ptr<storage::MappedFile> file_;
+    std::byte* payload_ = nullptr;
+    size_t payload_size_ = 0;
+    size_t position_ = 0;
+};
+
+} // namespace snapshot
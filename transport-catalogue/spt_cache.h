@@ -0,0 +1,104 @@
+#pragma once
+
+#include "graph.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Дерево кратчайших путей из одной вершины: веса и последние рёбра маршрутов
+template <typename Weight>
+struct ShortestPathTree {
+    std::vector<Weight> weights;
+    std::vector<CompactEdgeId> prev_edges;
+
+    static size_t GetByteSize(size_t vertex_count) {
+        return sizeof(ShortestPathTree) + vertex_count * (sizeof(Weight) + sizeof(CompactEdgeId));
+    }
+    size_t GetByteSize() const {
+        return GetByteSize(weights.size());
+    }
+};
+
+// Кэш деревьев кратчайших путей по вершине-источнику с вытеснением давно
+// не использованных (LRU) при превышении бюджета памяти. Деревья отдаются
+// через shared_ptr, поэтому восстановление маршрута идёт вне блокировки,
+// а вытеснение не портит дерево, которое ещё читает другой поток.
+template <typename Weight>
+class ShortestPathTreeCache {
+public:
+    using Tree = ShortestPathTree<Weight>;
+    using TreePtr = std::shared_ptr<const Tree>;
+
+    struct Stats {
+        size_t hit_count = 0;
+        size_t miss_count = 0;
+        size_t eviction_count = 0;
+        size_t byte_size = 0;
+    };
+
+    explicit ShortestPathTreeCache(size_t byte_budget)
+        : byte_budget_(byte_budget) {
+    }
+
+    TreePtr Find(VertexId source) {
+        std::lock_guard lock(mutex_);
+        auto it = index_.find(source);
+        if (it == index_.end()) {
+            ++stats_.miss_count;
+            return nullptr;
+        }
+        ++stats_.hit_count;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+
+    // Дерево больше всего бюджета не кэшируется
+    void Insert(VertexId source, TreePtr tree) {
+        const size_t tree_size = tree->GetByteSize();
+        if (tree_size > byte_budget_) {
+            return;
+        }
+        std::lock_guard lock(mutex_);
+        if (index_.count(source)) {
+            return;
+        }
+        while (stats_.byte_size + tree_size > byte_budget_) {
+            stats_.byte_size -= entries_.back().second->GetByteSize();
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+            ++stats_.eviction_count;
+        }
+        entries_.emplace_front(source, std::move(tree));
+        index_[source] = entries_.begin();
+        stats_.byte_size += tree_size;
+    }
+
+    void Clear() {
+        std::lock_guard lock(mutex_);
+        entries_.clear();
+        index_.clear();
+        stats_.byte_size = 0;
+    }
+
+    Stats GetStats() const {
+        std::lock_guard lock(mutex_);
+        return stats_;
+    }
+
+private:
+    using Entries = std::list<std::pair<VertexId, TreePtr>>;
+
+    const size_t byte_budget_;
+    mutable std::mutex mutex_;
+    Entries entries_;
+    std::unordered_map<VertexId, typename Entries::iterator> index_;
+    Stats stats_;
+};
+
+}  // namespace graph
@@ -0,0 +1,100 @@
+#include "thread_pool.h"
+
+namespace parallel {
+
+ThreadPool::ThreadPool (size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    workers_.reserve(thread_count - 1);
+
+    for (size_t i = 1; i < thread_count; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool () {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount () const {
+    return workers_.size() + 1;
+}
+
+void ThreadPool::ParallelFor (size_t task_count, const std::function<void(size_t)>& task) {
+    if (workers_.empty() || task_count <= 1) {
+        for (size_t i = 0; i < task_count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        task_ = &task;
+        task_count_ = task_count;
+        next_task_ = 0;
+        active_workers_ = workers_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    RunTasks();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock lock(mutex_);
+        done_cv_.wait(lock, [this] { return active_workers_ == 0; });
+        task_ = nullptr;
+        error = error_;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::WorkerLoop () {
+    size_t seen_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            start_cv_.wait(lock, [this, seen_generation] { return stop_ || generation_ != seen_generation; });
+            if (stop_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        RunTasks();
+
+        std::lock_guard lock(mutex_);
+        if (--active_workers_ == 0) {
+            done_cv_.notify_all();
+        }
+    }
+}
+
+void ThreadPool::RunTasks () {
+    for (size_t i = next_task_.fetch_add(1); i < task_count_; i = next_task_.fetch_add(1)) {
+        try {
+            (*task_)(i);
+        } catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+} // namespace parallel
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+// Пул потоков фиксированного размера. Вызывающий поток тоже участвует
+// в работе, поэтому создаётся thread_count - 1 рабочих потоков.
+class ThreadPool {
+public:
+    // thread_count == 0 — по числу аппаратных потоков
+    explicit ThreadPool (size_t thread_count);
+    ~ThreadPool ();
+
+    ThreadPool (const ThreadPool&) = delete;
+    ThreadPool& operator= (const ThreadPool&) = delete;
+
+    size_t GetThreadCount () const;
+
+    // Выполняет task(0) ... task(task_count - 1) и дожидается завершения всех задач.
+    // Первое исключение из задач пробрасывается в вызывающий поток.
+    void ParallelFor (size_t task_count, const std::function<void(size_t)>& task);
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t task_count_ = 0;
+    std::atomic<size_t> next_task_ = 0;
+    size_t active_workers_ = 0;
+    size_t generation_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+
+    void WorkerLoop ();
+    void RunTasks ();
+};
+
+} // namespace parallel
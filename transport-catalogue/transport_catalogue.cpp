@@ -1,35 +1,339 @@
 #include "transport_catalogue.h"
+#include "thread_pool.h"
 
-#include <unordered_set>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
 
 namespace trans_cat {
 
-size_t TransportCatalogue::DistHasher::operator()(const std::pair<const domain::Stop*, const domain::Stop*>& stops) const {
-    size_t h_first_stop = dist_hasher_(stops.first);
-    size_t h_sec_stop = dist_hasher_(stops.second);
-    return h_first_stop + h_sec_stop * 37;
+namespace {
+
+std::uint64_t MakeDistKey (domain::StopId stop_from, domain::StopId stop_to) {
+    return static_cast<std::uint64_t>(stop_from) << 32 | stop_to;
 }
 
-void TransportCatalogue::AddBus (const std::string& bus_name, const std::vector<domain::Stop*>& stops_for_bus, bool is_roundtrip){
-    bus_data_.push_back(domain::Bus{bus_name, stops_for_bus, is_roundtrip});
-    bus_directory_[bus_data_.back().bus_name] = &bus_data_.back();
+// Номер следующего элемента; номера 32-битные
+std::uint32_t MakeNextId (size_t size) {
+    if (size >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("Too many items in the catalogue");
+    }
+    return static_cast<std::uint32_t>(size);
+}
+
+// Таблица ячеек для поиска по имени: name(item) — имя элемента с номером item
+template <typename NameGetter>
+std::vector<std::uint32_t> MakeNameSlots (size_t count, std::uint32_t empty_slot, NameGetter name) {
+    size_t slot_count = 1;
+    while (slot_count < count * 2) {
+        slot_count *= 2;
+    }
+    std::vector<std::uint32_t> slots(slot_count, empty_slot);
+    for (std::uint32_t item = 0; item < count; ++item) {
+        size_t slot = std::hash<std::string_view>{}(name(item)) & (slot_count - 1);
+        while (slots[slot] != empty_slot) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot] = item;
+    }
+    return slots;
+}
+
+template <typename NameGetter>
+std::uint32_t FindNameSlot (const std::vector<std::uint32_t>& slots, std::uint32_t empty_slot, std::string_view key, NameGetter name) {
+    size_t slot = std::hash<std::string_view>{}(key) & (slots.size() - 1);
+    while (slots[slot] != empty_slot && name(slots[slot]) != key) {
+        slot = (slot + 1) & (slots.size() - 1);
+    }
+    return slots[slot];
+}
+
+void CheckNotFrozen (bool frozen) {
+    if (frozen) {
+        throw std::logic_error("Catalogue is frozen");
+    }
+}
 
-    for(const domain::Stop* stop : bus_data_.back().stops_for_bus){
-        bus_list_for_stop_[stop->stop_name].insert(bus_data_.back().bus_name);
+} // namespace
+
+domain::BusId TransportCatalogue::AddBus (const std::string& bus_name, const std::vector<const domain::Stop*>& stops_for_bus, bool is_roundtrip){
+    CheckNotFrozen(frozen_);
+    std::vector<domain::StopId> stop_ids;
+    stop_ids.reserve(stops_for_bus.size());
+    for(const domain::Stop* stop : stops_for_bus){
+        stop_ids.push_back(stop->stop_id);
     }
+
+    const domain::BusId bus_id = MakeNextId(bus_data_.size());
+    bus_data_.push_back(domain::Bus{bus_name, std::move(stop_ids), is_roundtrip, bus_id});
+    bus_directory_[bus_data_.back().bus_name] = &bus_data_.back();
+    return bus_id;
 }
 
 void TransportCatalogue::SetDistBetweenStops (const domain::Stop* stop_from, const domain::Stop* stop_to, size_t distance){
-    dist_directory_[std::make_pair(stop_from, stop_to)] = distance;
+    if (!stop_from || !stop_to) {
+        throw std::invalid_argument("Unknown stop in road distance");
+    }
+    SetDistBetweenStops(stop_from->stop_id, stop_to->stop_id, distance);
+}
+
+void TransportCatalogue::SetDistBetweenStops (domain::StopId stop_from, domain::StopId stop_to, size_t distance){
+    if (!frozen_) {
+        dist_directory_[MakeDistKey(stop_from, stop_to)] = distance;
+        return;
+    }
+
+    // У известной пары в индексе есть обе строки: своя и обратная
+    const size_t forward = dist_index_.Find(stop_from, stop_to);
+    const size_t backward = dist_index_.Find(stop_to, stop_from);
+    if (forward == dist_index_.stop_ids.size() || backward == dist_index_.stop_ids.size()) {
+        throw std::logic_error("Catalogue is frozen, cannot add a new distance");
+    }
+    dist_index_.distances[forward] = distance;
+    dist_index_.is_explicit[forward] = true;
+    if (!dist_index_.is_explicit[backward]) {
+        dist_index_.distances[backward] = distance;
+    }
+
+    // Пару проезжают только автобусы остановки stop_from
+    for (std::uint32_t i = stop_bus_offsets_[stop_from]; i < stop_bus_offsets_[stop_from + 1]; ++i) {
+        const domain::BusId bus_id = stop_bus_ids_[i];
+        bus_stats_[bus_id].route_length = GetBusRouteLength(bus_data_[bus_id]);
+    }
+}
+
+void TransportCatalogue::Freeze (size_t thread_count){
+    if (frozen_) {
+        return;
+    }
+    FreezeDistances();
+    FreezeNames();
+    FreezeStopBuses();
+    FreezeBusStats(thread_count);
+
+    // Структуры заполнения больше не нужны; присваивание пустых освобождает их память
+    dist_directory_ = decltype(dist_directory_){};
+    stop_directory_ = decltype(stop_directory_){};
+    bus_directory_ = decltype(bus_directory_){};
+    frozen_ = true;
+}
+
+bool TransportCatalogue::IsFrozen () const {
+    return frozen_;
+}
+
+void TransportCatalogue::FreezeNames (){
+    stop_ids_by_name_.resize(stop_data_.size());
+    for (domain::StopId stop_id = 0; stop_id < stop_data_.size(); ++stop_id) {
+        stop_ids_by_name_[stop_id] = stop_id;
+    }
+    std::sort(stop_ids_by_name_.begin(), stop_ids_by_name_.end(), [this](domain::StopId lhs, domain::StopId rhs) {
+        return stop_data_[lhs].stop_name < stop_data_[rhs].stop_name;
+    });
+
+    bus_ids_by_name_.resize(bus_data_.size());
+    for (domain::BusId bus_id = 0; bus_id < bus_data_.size(); ++bus_id) {
+        bus_ids_by_name_[bus_id] = bus_id;
+    }
+    std::sort(bus_ids_by_name_.begin(), bus_ids_by_name_.end(), [this](domain::BusId lhs, domain::BusId rhs) {
+        return bus_data_[lhs].bus_name < bus_data_[rhs].bus_name;
+    });
+
+    stop_slots_ = MakeNameSlots(stop_data_.size(), EMPTY_SLOT, [this](domain::StopId stop_id) -> std::string_view {
+        return stop_data_[stop_id].stop_name;
+    });
+    bus_slots_ = MakeNameSlots(bus_data_.size(), EMPTY_SLOT, [this](domain::BusId bus_id) -> std::string_view {
+        return bus_data_[bus_id].bus_name;
+    });
+}
+
+// Автобусы добавляются в списки в алфавитном порядке, поэтому списки сразу отсортированы.
+// last_bus отсекает повторный заход автобуса на ту же остановку
+void TransportCatalogue::FreezeStopBuses (){
+    constexpr domain::BusId NO_BUS = std::numeric_limits<domain::BusId>::max();
+    std::vector<domain::BusId> last_bus(stop_data_.size(), NO_BUS);
+
+    stop_bus_offsets_.assign(stop_data_.size() + 1, 0);
+    for (const domain::BusId bus_id : bus_ids_by_name_) {
+        for (const domain::StopId stop_id : bus_data_[bus_id].stop_ids) {
+            if (last_bus[stop_id] != bus_id) {
+                last_bus[stop_id] = bus_id;
+                ++stop_bus_offsets_[stop_id + 1];
+            }
+        }
+    }
+    for (size_t stop_id = 0; stop_id < stop_data_.size(); ++stop_id) {
+        stop_bus_offsets_[stop_id + 1] += stop_bus_offsets_[stop_id];
+    }
+
+    stop_bus_ids_.resize(stop_bus_offsets_.back());
+    std::vector<std::uint32_t> positions(stop_bus_offsets_.begin(), stop_bus_offsets_.end() - 1);
+    last_bus.assign(stop_data_.size(), NO_BUS);
+    for (const domain::BusId bus_id : bus_ids_by_name_) {
+        for (const domain::StopId stop_id : bus_data_[bus_id].stop_ids) {
+            if (last_bus[stop_id] != bus_id) {
+                last_bus[stop_id] = bus_id;
+                stop_bus_ids_[positions[stop_id]++] = bus_id;
+            }
+        }
+    }
+}
+
+// Автобусы считаются независимо, каждый пишет только свою ячейку
+void TransportCatalogue::FreezeBusStats (size_t thread_count){
+    bus_stats_.assign(bus_data_.size(), domain::BusStat{});
+    parallel::ThreadPool pool(thread_count);
+    pool.ParallelFor(bus_data_.size(), [this](size_t bus_id) {
+        bus_stats_[bus_id] = ComputeBusStat(bus_data_[bus_id]);
+    });
+}
+
+void TransportCatalogue::FreezeDistances (){
+    struct Entry {
+        domain::StopId stop_from;
+        domain::StopId stop_to;
+        size_t distance;
+        bool is_explicit;
+
+        bool operator< (const Entry& other) const {
+            return std::tie(stop_from, stop_to) < std::tie(other.stop_from, other.stop_to);
+        }
+    };
+
+    std::vector<Entry> entries;
+    entries.reserve(dist_directory_.size() * 2);
+    for (const auto& [stops, distance] : dist_directory_) {
+        const auto stop_from = static_cast<domain::StopId>(stops >> 32);
+        const auto stop_to = static_cast<domain::StopId>(stops);
+        entries.push_back({stop_from, stop_to, distance, true});
+        if (!dist_directory_.count(MakeDistKey(stop_to, stop_from))) {
+            entries.push_back({stop_to, stop_from, distance, false});
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    if (entries.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("Too many distances in the catalogue");
+    }
+    DistanceIndex index;
+    index.offsets.assign(stop_data_.size() + 1, 0);
+    index.stop_ids.reserve(entries.size());
+    index.distances.reserve(entries.size());
+    index.is_explicit.reserve(entries.size());
+    for (const Entry& entry : entries) {
+        ++index.offsets[entry.stop_from + 1];
+        index.stop_ids.push_back(entry.stop_to);
+        index.distances.push_back(entry.distance);
+        index.is_explicit.push_back(entry.is_explicit);
+    }
+    for (size_t stop_id = 0; stop_id < stop_data_.size(); ++stop_id) {
+        index.offsets[stop_id + 1] += index.offsets[stop_id];
+    }
+    dist_index_ = std::move(index);
+}
+
+size_t TransportCatalogue::DistanceIndex::Find (domain::StopId stop_from, domain::StopId stop_to) const {
+    if (stop_from + size_t{1} >= offsets.size()) {
+        return stop_ids.size();
+    }
+    const auto row_begin = stop_ids.begin() + offsets[stop_from];
+    const auto row_end = stop_ids.begin() + offsets[stop_from + 1];
+    const auto it = std::lower_bound(row_begin, row_end, stop_to);
+    return it != row_end && *it == stop_to ? static_cast<size_t>(it - stop_ids.begin()) : stop_ids.size();
 }
 	
-void TransportCatalogue::AddStop (const std::string& stop_name, geo::Coordinates stop_coord){
-    stop_data_.push_back(domain::Stop{stop_name, stop_coord});
+domain::StopId TransportCatalogue::AddStop (const std::string& stop_name, geo::Coordinates stop_coord){
+    CheckNotFrozen(frozen_);
+    const domain::StopId stop_id = MakeNextId(stop_data_.size());
+    stop_data_.push_back(domain::Stop{stop_name, stop_coord, stop_id});
     stop_directory_[stop_data_.back().stop_name] = &stop_data_.back();
-    bus_list_for_stop_[stop_data_.back().stop_name] = {};
+    return stop_id;
 }
 
-domain::Bus* TransportCatalogue::GetBusByName (std::string_view bus_name) const {
+void TransportCatalogue::Save (snapshot::Writer& writer) const {
+    writer.WriteValue<std::uint64_t>(stop_data_.size());
+    for (const domain::Stop& stop : stop_data_) {
+        writer.WriteString(stop.stop_name);
+        writer.WriteValue(stop.stop_coord);
+    }
+
+    writer.WriteValue<std::uint64_t>(bus_data_.size());
+    for (const domain::Bus& bus : bus_data_) {
+        writer.WriteString(bus.bus_name);
+        writer.WriteValue<std::uint8_t>(bus.is_roundtrip);
+        writer.WriteVector(bus.stop_ids);
+    }
+
+    // После Freeze заданные расстояния — явные записи индекса
+    if (frozen_) {
+        writer.WriteValue<std::uint64_t>(std::count(dist_index_.is_explicit.begin(), dist_index_.is_explicit.end(), true));
+        for (domain::StopId stop_from = 0; stop_from < stop_data_.size(); ++stop_from) {
+            for (size_t i = dist_index_.offsets[stop_from]; i < dist_index_.offsets[stop_from + 1]; ++i) {
+                if (dist_index_.is_explicit[i]) {
+                    writer.WriteValue<std::uint32_t>(stop_from);
+                    writer.WriteValue<std::uint32_t>(dist_index_.stop_ids[i]);
+                    writer.WriteValue<std::uint64_t>(dist_index_.distances[i]);
+                }
+            }
+        }
+        return;
+    }
+    writer.WriteValue<std::uint64_t>(dist_directory_.size());
+    for (const auto& [stops, distance] : dist_directory_) {
+        writer.WriteValue<std::uint32_t>(static_cast<std::uint32_t>(stops >> 32));
+        writer.WriteValue<std::uint32_t>(static_cast<std::uint32_t>(stops));
+        writer.WriteValue<std::uint64_t>(distance);
+    }
+}
+
+void TransportCatalogue::Load (snapshot::Reader& reader) {
+    const auto stop_count = reader.ReadValue<std::uint64_t>();
+    for (std::uint64_t i = 0; i < stop_count; ++i) {
+        const std::string_view stop_name = reader.ReadString();
+        AddStop(std::string(stop_name), reader.ReadValue<geo::Coordinates>());
+    }
+
+    const auto get_stop = [this](std::uint32_t stop_id) {
+        if (stop_id >= stop_data_.size()) {
+            throw snapshot::FormatError("Stop id is out of range in snapshot");
+        }
+        return &stop_data_[stop_id];
+    };
+
+    const auto bus_count = reader.ReadValue<std::uint64_t>();
+    for (std::uint64_t i = 0; i < bus_count; ++i) {
+        const std::string_view bus_name = reader.ReadString();
+        const bool is_roundtrip = reader.ReadValue<std::uint8_t>() != 0;
+        const auto stop_ids = reader.ReadVector<domain::StopId>();
+
+        std::vector<const domain::Stop*> stops;
+        stops.reserve(stop_ids.size());
+        for (const domain::StopId stop_id : stop_ids) {
+            stops.push_back(get_stop(stop_id));
+        }
+        AddBus(std::string(bus_name), stops, is_roundtrip);
+    }
+
+    const auto dist_count = reader.ReadValue<std::uint64_t>();
+    dist_directory_.reserve(dist_count);
+    for (std::uint64_t i = 0; i < dist_count; ++i) {
+        const domain::Stop* stop_from = get_stop(reader.ReadValue<std::uint32_t>());
+        const domain::Stop* stop_to   = get_stop(reader.ReadValue<std::uint32_t>());
+        SetDistBetweenStops(stop_from, stop_to, reader.ReadValue<std::uint64_t>());
+    }
+    Freeze();
+}
+
+const domain::Bus* TransportCatalogue::GetBusByName (std::string_view bus_name) const {
+    if (frozen_) {
+        const domain::BusId bus_id = FindNameSlot(bus_slots_, EMPTY_SLOT, bus_name, [this](domain::BusId id) -> std::string_view {
+            return bus_data_[id].bus_name;
+        });
+        return bus_id != EMPTY_SLOT ? &bus_data_[bus_id] : nullptr;
+    }
+
     auto it = bus_directory_.find(bus_name);
     
     if(it != bus_directory_.end()){
@@ -38,7 +342,14 @@ domain::Bus* TransportCatalogue::GetBusByName (std::string_view bus_name) const
     return nullptr;
 }
 	
-domain::Stop* TransportCatalogue::GetStopByName (std::string_view stop_name) const {
+const domain::Stop* TransportCatalogue::GetStopByName (std::string_view stop_name) const {
+    if (frozen_) {
+        const domain::StopId stop_id = FindNameSlot(stop_slots_, EMPTY_SLOT, stop_name, [this](domain::StopId id) -> std::string_view {
+            return stop_data_[id].stop_name;
+        });
+        return stop_id != EMPTY_SLOT ? &stop_data_[stop_id] : nullptr;
+    }
+
     auto it = stop_directory_.find(stop_name);
 
     if(it != stop_directory_.end()){
@@ -47,38 +358,85 @@ domain::Stop* TransportCatalogue::GetStopByName (std::string_view stop_name) con
     return nullptr;
 }
 
+const domain::Stop* TransportCatalogue::GetStopById (domain::StopId stop_id) const {
+    return stop_id < stop_data_.size() ? &stop_data_[stop_id] : nullptr;
+}
+
+const domain::Bus* TransportCatalogue::GetBusById (domain::BusId bus_id) const {
+    return bus_id < bus_data_.size() ? &bus_data_[bus_id] : nullptr;
+}
+
+const std::deque<domain::Stop>& TransportCatalogue::GetStops () const {
+    return stop_data_;
+}
+
+const std::deque<domain::Bus>& TransportCatalogue::GetBuses () const {
+    return bus_data_;
+}
+
+std::vector<const domain::Bus*> TransportCatalogue::GetBusesByName () const {
+    std::vector<const domain::Bus*> buses;
+    buses.reserve(bus_data_.size());
+    if (frozen_) {
+        for (const domain::BusId bus_id : bus_ids_by_name_) {
+            buses.push_back(&bus_data_[bus_id]);
+        }
+    } else {
+        for (const auto& [bus_name, bus] : bus_directory_) {
+            buses.push_back(bus);
+        }
+    }
+    return buses;
+}
+
 domain::BusStat TransportCatalogue::GetBusPropertyByName (std::string_view bus_name) const {
     domain::BusStat bus_property;
     
     const domain::Bus* bus = GetBusByName(bus_name);
 
     if(bus){
-        bus_property.all_stop_count   = GetBusAllStopCount(*bus);
-        bus_property.uniq_stop_count  = GetBusUniqStopCount(*bus);
-        bus_property.route_geo_length = GetBusGeoRouteLength(*bus);
-        bus_property.route_length     = GetBusRouteLength(*bus);
+        bus_property = frozen_ ? bus_stats_[bus->bus_id] : ComputeBusStat(*bus);
     } 
     return bus_property;
 }
 
-const std::set<std::string>& TransportCatalogue::GetStopPropertyByName(std::string_view stop_name) const {
-    static std::set<std::string> result;
-    auto it = bus_list_for_stop_.find(stop_name);
+domain::BusStat TransportCatalogue::ComputeBusStat (const domain::Bus& bus) const {
+    domain::BusStat bus_property;
+    bus_property.all_stop_count   = GetBusAllStopCount(bus);
+    bus_property.uniq_stop_count  = GetBusUniqStopCount(bus);
+    bus_property.route_geo_length = GetBusGeoRouteLength(bus);
+    bus_property.route_length     = GetBusRouteLength(bus);
+    return bus_property;
+}
 
-    if(it != bus_list_for_stop_.end()){
-        result = it -> second;
+ranges::Range<const domain::BusId*> TransportCatalogue::GetBusIdsForStop (domain::StopId stop_id) const {
+    if (!frozen_) {
+        throw std::logic_error("Catalogue is not frozen");
     }
-    return result;
+    if (stop_id >= stop_data_.size()) {
+        throw std::out_of_range("Unknown stop id");
+    }
+    const domain::BusId* bus_ids = stop_bus_ids_.data();
+    return {bus_ids + stop_bus_offsets_[stop_id], bus_ids + stop_bus_offsets_[stop_id + 1]};
 }
 
 size_t TransportCatalogue::GetDistBetweenStops (const domain::Stop* stop_from, const domain::Stop* stop_to) const {
-    auto it = dist_directory_.find({stop_from, stop_to});
+    return GetDistBetweenStops(stop_from->stop_id, stop_to->stop_id);
+}
+
+size_t TransportCatalogue::GetDistBetweenStops (domain::StopId stop_from, domain::StopId stop_to) const {
+    if (dist_index_.IsBuilt()) {
+        const size_t position = dist_index_.Find(stop_from, stop_to);
+        return position != dist_index_.stop_ids.size() ? dist_index_.distances[position] : 0;
+    }
+
+    auto it = dist_directory_.find(MakeDistKey(stop_from, stop_to));
     size_t result = 0;
 
     if(it != dist_directory_.end()){
         result = it->second;
     } else {
-        it = dist_directory_.find({stop_to, stop_from});
+        it = dist_directory_.find(MakeDistKey(stop_to, stop_from));
 
         if(it != dist_directory_.end()){
             result = it->second;
@@ -87,30 +445,19 @@ size_t TransportCatalogue::GetDistBetweenStops (const domain::Stop* stop_from, c
     return result;
 }
 
-const std::map<std::string_view, domain::Bus*>& TransportCatalogue::GetBusDirectory () const {
-    return bus_directory_;
-}
-
-const std::unordered_map<std::string_view, domain::Stop*>& TransportCatalogue::GetStopDirectory () const {
-    return stop_directory_;
-}
-
 int TransportCatalogue::GetBusUniqStopCount(const domain::Bus& bus) const {
-    std::unordered_set<std::string> stops;
-
-    for(const auto& stop : bus.stops_for_bus){
-        stops.insert(stop->stop_name);
-    }
-    return static_cast<int>(stops.size());
+    std::vector<domain::StopId> stop_ids = bus.stop_ids;
+    std::sort(stop_ids.begin(), stop_ids.end());
+    return static_cast<int>(std::unique(stop_ids.begin(), stop_ids.end()) - stop_ids.begin());
 }
 
 int TransportCatalogue::GetBusAllStopCount(const domain::Bus& bus) const {
     int result;
     
     if (bus.is_roundtrip) {
-        result = static_cast<int>(bus.stops_for_bus.size());
+        result = static_cast<int>(bus.stop_ids.size());
     } else {
-        result = static_cast<int>(bus.stops_for_bus.size() * 2 - 1);
+        result = static_cast<int>(bus.stop_ids.size() * 2 - 1);
     }
     return result;
 }
@@ -118,11 +465,13 @@ int TransportCatalogue::GetBusAllStopCount(const domain::Bus& bus) const {
 double TransportCatalogue::GetBusGeoRouteLength(const domain::Bus& bus) const {
     double result = 0.0;
 
-    for(size_t i = 1; i < bus.stops_for_bus.size(); ++i){
+    for(size_t i = 1; i < bus.stop_ids.size(); ++i){
+        const geo::Coordinates& coord_from = stop_data_[bus.stop_ids[i - 1]].stop_coord;
+        const geo::Coordinates& coord_to   = stop_data_[bus.stop_ids[i]].stop_coord;
         if (bus.is_roundtrip) {
-            result += geo::ComputeDistance(bus.stops_for_bus[i - 1]->stop_coord, bus.stops_for_bus[i]->stop_coord);
+            result += geo::ComputeDistance(coord_from, coord_to);
         } else {
-            result += geo::ComputeDistance(bus.stops_for_bus[i - 1]->stop_coord, bus.stops_for_bus[i]->stop_coord) * 2;
+            result += geo::ComputeDistance(coord_from, coord_to) * 2;
         }
     }
     return result;
@@ -131,12 +480,12 @@ double TransportCatalogue::GetBusGeoRouteLength(const domain::Bus& bus) const {
 int TransportCatalogue::GetBusRouteLength (const domain::Bus& bus) const {
     int result = 0;    
 
-    for(size_t i = 0; i < bus.stops_for_bus.size() - 1; ++i){
-        result += static_cast<int>(GetDistBetweenStops(bus.stops_for_bus[i], bus.stops_for_bus[i + 1]));
+    for(size_t i = 0; i < bus.stop_ids.size() - 1; ++i){
+        result += static_cast<int>(GetDistBetweenStops(bus.stop_ids[i], bus.stop_ids[i + 1]));
     }
     if (!bus.is_roundtrip) {
-        for(size_t j = bus.stops_for_bus.size() - 1; j > 0; --j){
-            result += static_cast<int>(GetDistBetweenStops(bus.stops_for_bus[j], bus.stops_for_bus[j - 1]));
+        for(size_t j = bus.stop_ids.size() - 1; j > 0; --j){
+            result += static_cast<int>(GetDistBetweenStops(bus.stop_ids[j], bus.stop_ids[j - 1]));
         }
     }
     return result;
@@ -1,8 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <deque>
 #include <map>
-#include <set>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -10,56 +10,120 @@
 
 #include "domain.h"
 #include "geo.h"
+#include "ranges.h"
+#include "snapshot.h"
 
 namespace trans_cat {
 
 class TransportCatalogue {
 public:
-	struct DistHasher {
-	public:
-		size_t operator()(const std::pair<const domain::Stop*, const domain::Stop*>& stops) const;
-	private:
-		std::hash<const void*> dist_hasher_;
-	};
-	
-	// Добавление автобусов / остановок / дистанций между остановками в БД
-	void AddBus (const std::string& bus_name, const std::vector<domain::Stop*>& stops_for_bus, bool is_roundtrip);
-	void AddStop (const std::string& stop_name, geo::Coordinates stop_coord);
+	// Добавление автобусов / остановок / дистанций между остановками в БД.
+	// Номера выдаются подряд с нуля в порядке добавления
+	domain::BusId AddBus (const std::string& bus_name, const std::vector<const domain::Stop*>& stops_for_bus, bool is_roundtrip);
+	domain::StopId AddStop (const std::string& stop_name, geo::Coordinates stop_coord);
 	void SetDistBetweenStops (const domain::Stop* stop_from, const domain::Stop* stop_to, size_t distance);
+	void SetDistBetweenStops (domain::StopId stop_from, domain::StopId stop_to, size_t distance);
+
+	// Переводит заполненный каталог в компактное представление только для чтения:
+	// отсортированные по именам таблицы номеров, списки автобусов остановок и
+	// расстояния в CSR-массивах. Структуры заполнения освобождаются. После Freeze
+	// можно только менять расстояние уже известной пары, остальные изменения
+	// бросают std::logic_error. Там же параллельно считается статистика всех
+	// автобусов; thread_count == 0 — по числу аппаратных потоков
+	void Freeze (size_t thread_count = 0);
+	bool IsFrozen () const;
+
+	// Запись каталога в снимок и заполнение пустого каталога из снимка.
+	// Остановки и автобусы пишутся в порядке номеров, поэтому номера сохраняются
+	void Save (snapshot::Writer& writer) const;
+	void Load (snapshot::Reader& reader);
 
 	// Получение информации из БД
 
 	// Получение автобуса / остановки по имени
-	domain::Bus* GetBusByName (std::string_view bus_name) const;
-	domain::Stop* GetStopByName (std::string_view stop_name) const;
+	const domain::Bus* GetBusByName (std::string_view bus_name) const;
+	const domain::Stop* GetStopByName (std::string_view stop_name) const;
+
+	// Получение автобуса / остановки по номеру, nullptr — номер вне диапазона
+	const domain::Stop* GetStopById (domain::StopId stop_id) const;
+	const domain::Bus* GetBusById (domain::BusId bus_id) const;
+
+	// Все остановки / автобусы в порядке номеров: stops[stop_id]
+	const std::deque<domain::Stop>& GetStops () const;
+	const std::deque<domain::Bus>& GetBuses () const;
+
+	// Автобусы в алфавитном порядке имён
+	std::vector<const domain::Bus*> GetBusesByName () const;
 	
 	// Запрос свойств для конкретного автобуса
 	domain::BusStat GetBusPropertyByName (std::string_view bus_name) const;
 
-	// Запрос свойств для конкретной остановки
-	const std::set<std::string>& GetStopPropertyByName(std::string_view stop_name) const;
+	// Автобусы остановки в алфавитном порядке имён, без повторов. Диапазон
+	// ссылается на память каталога и живёт вместе с ним; доступен после Freeze,
+	// иначе std::logic_error. Номер вне диапазона — std::out_of_range
+	ranges::Range<const domain::BusId*> GetBusIdsForStop (domain::StopId stop_id) const;
 
 	// Получение расстояния между остановками
 	size_t GetDistBetweenStops (const domain::Stop* stop_from, const domain::Stop* stop_to) const;
-	
-	// Получение катологов для ладьнейшей обработки
-	const std::map<std::string_view, domain::Bus*>& GetBusDirectory () const;
-	const std::unordered_map<std::string_view, domain::Stop*>& GetStopDirectory () const;
+	size_t GetDistBetweenStops (domain::StopId stop_from, domain::StopId stop_to) const;
 
 private:
 	// БД автобусов и остановок
 	std::deque<domain::Bus>  bus_data_;
 	std::deque<domain::Stop> stop_data_;
 
-	// справочник автобусов / остановок
+	// справочник автобусов / остановок (до Freeze)
 	std::map<std::string_view, domain::Bus*> bus_directory_;
 	std::unordered_map<std::string_view, domain::Stop*> stop_directory_;
 
-	// Справочник автобусов для остановки
-	std::unordered_map<std::string_view, std::set<std::string>> bus_list_for_stop_;
+	// Справочник расстояний между остановками по паре номеров (from << 32 | to) (до Freeze)
+	std::unordered_map<std::uint64_t, size_t> dist_directory_;
+
+	bool frozen_ = false;
+
+	// Номера остановок / автобусов, отсортированные по именам: обход в алфавитном порядке (после Freeze)
+	std::vector<domain::StopId> stop_ids_by_name_;
+	std::vector<domain::BusId> bus_ids_by_name_;
+
+	// Поиск по имени: открытая адресация с линейным пробированием, в ячейке номер
+	// или EMPTY_SLOT. Размер — степень двойки, не меньше удвоенного числа имён (после Freeze)
+	static constexpr std::uint32_t EMPTY_SLOT = UINT32_MAX;
+	std::vector<domain::StopId> stop_slots_;
+	std::vector<domain::BusId> bus_slots_;
+
+	// Автобусы остановки stop_id — [stop_bus_offsets_[stop_id], stop_bus_offsets_[stop_id + 1])
+	// в stop_bus_ids_, в алфавитном порядке имён, без повторов (после Freeze)
+	std::vector<std::uint32_t> stop_bus_offsets_;
+	std::vector<domain::BusId> stop_bus_ids_;
+
+	// Замороженные расстояния: строка остановки from — [offsets[from], offsets[from + 1])
+	// в параллельных массивах, отсортированная по to. Пара, заданная только в одну
+	// сторону, попадает в обе строки, поэтому поиск — один проход по строке без хеширования
+	struct DistanceIndex {
+		std::vector<std::uint32_t> offsets;
+		std::vector<domain::StopId> stop_ids;
+		std::vector<size_t> distances;
+		// Расстояние задано для этого направления, а не взято из обратного
+		std::vector<bool> is_explicit;
+
+		bool IsBuilt () const {
+			return !offsets.empty();
+		}
+		// Позиция пары в массивах или stop_ids.size(), если её нет
+		size_t Find (domain::StopId stop_from, domain::StopId stop_to) const;
+	};
+	DistanceIndex dist_index_;
+
+	// Статистика автобусов по номерам (после Freeze). Изменение расстояния
+	// пересчитывает длину маршрута у автобусов, проходящих через пару
+	std::vector<domain::BusStat> bus_stats_;
+
+	void FreezeDistances ();
+	void FreezeNames ();
+	void FreezeStopBuses ();
+	void FreezeBusStats (size_t thread_count);
 
-	// Справочник расстояний между остановками
-	std::unordered_map<std::pair<const domain::Stop*, const domain::Stop*>, size_t, DistHasher> dist_directory_;
+	domain::BusStat ComputeBusStat (const domain::Bus& bus) const;
 	
 	int 	GetBusAllStopCount 	 (const domain::Bus& bus) const;
 	double	GetBusGeoRouteLength (const domain::Bus& bus) const;
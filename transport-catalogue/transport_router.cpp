@@ -1,101 +1,844 @@
 #include "transport_router.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
 namespace transport_router {
 
 TransportRouter::TransportRouter (const trans_cat::TransportCatalogue& catalogue, const RouteSettings& settings) 
     : route_settings_ (settings)
     , catalogue_ (catalogue) {
+        const size_t page_fault_count = storage::GetPageFaultCount ();
         BuildAllRoutes ();
+        UpdateMemoryStats (page_fault_count);
+}
+
+namespace {
+
+constexpr std::uint32_t HILBERT_ORDER = 16;
+constexpr double HILBERT_MAX_CELL = (1u << HILBERT_ORDER) - 1;
+
+// Номер клетки (x, y) решётки 2^HILBERT_ORDER x 2^HILBERT_ORDER вдоль кривой Гильберта
+std::uint64_t ComputeHilbertIndex (std::uint32_t x, std::uint32_t y) {
+    const std::uint32_t side = 1u << HILBERT_ORDER;
+    std::uint64_t index = 0;
+    for (std::uint32_t half = side / 2; half > 0; half /= 2) {
+        const std::uint32_t rx = (x & half) ? 1 : 0;
+        const std::uint32_t ry = (y & half) ? 1 : 0;
+        index += static_cast<std::uint64_t>(half) * half * ((3 * rx) ^ ry);
+        // Поворот четверти, чтобы кривая внутри неё шла в нужном направлении
+        if (ry == 0) {
+            if (rx == 1) {
+                x = side - 1 - x;
+                y = side - 1 - y;
+            }
+            std::swap (x, y);
+        }
+    }
+    return index;
+}
+
+// Предрасчёт движка в снимке
+enum class SnapshotEngine : std::uint8_t {
+    None,
+    Table,
+    FloatTable,
+    ContractionHierarchy,
+    Landmarks
+};
+
+constexpr std::uint32_t NO_STOP = std::numeric_limits<std::uint32_t>::max();
+
+// Значение перечисления из байта снимка; байт вне [0, last] — повреждённый снимок
+template <typename Enum>
+Enum ToEnum (std::uint8_t value, Enum last) {
+    if (value > static_cast<std::uint8_t>(last)) {
+        throw snapshot::FormatError ("Enum value is out of range in snapshot");
+    }
+    return static_cast<Enum>(value);
+}
+
+template <typename Enum>
+Enum ReadEnum (snapshot::Reader& reader, Enum last) {
+    return ToEnum (reader.ReadValue<std::uint8_t>(), last);
+}
+
+} // namespace
+
+TransportRouter::TransportRouter (const trans_cat::TransportCatalogue& catalogue, snapshot::Reader& reader)
+    : catalogue_ (catalogue) {
+        const size_t page_fault_count = storage::GetPageFaultCount ();
+        route_settings_.bus_wait_time     = reader.ReadValue<std::int32_t>();
+        route_settings_.bus_velocity      = reader.ReadValue<double>();
+        route_settings_.router_type       = ReadEnum (reader, RouterType::AStar);
+        route_settings_.thread_count      = reader.ReadValue<std::uint64_t>();
+        route_settings_.use_float_weights = reader.ReadValue<std::uint8_t>() != 0;
+        route_settings_.landmark_count    = reader.ReadValue<std::uint64_t>();
+        route_settings_.graph_model       = ReadEnum (reader, GraphModel::Line);
+        route_settings_.spt_cache_bytes   = reader.ReadValue<std::uint64_t>();
+        route_settings_.vertex_order      = ReadEnum (reader, VertexOrder::Hilbert);
+        route_settings_.memory_policy.page_size      = ReadEnum (reader, storage::PageSize::Explicit);
+        route_settings_.memory_policy.numa_placement = ReadEnum (reader, storage::NumaPlacement::Local);
+        graph_stats_ = reader.ReadValue<GraphStats>();
+
+        const auto get_stop = [&catalogue](std::uint32_t stop_id) {
+            const domain::Stop* stop = catalogue.GetStopById (stop_id);
+            if (!stop) {
+                throw snapshot::FormatError ("Stop id is out of range in snapshot");
+            }
+            return stop;
+        };
+
+        vertexes_ = reader.ReadVector<StopVertex>();
+        if (vertexes_.size() != catalogue.GetStops ().size()) {
+            throw snapshot::FormatError ("Router snapshot does not match the catalogue");
+        }
+
+        // Имена действий — номера остановок (Wait) и автобусов (Bus) в каталоге
+
+        const auto item_types = reader.ReadVector<std::uint8_t>();
+        const auto name_ids   = reader.ReadVector<std::uint32_t>();
+        const auto distances  = reader.ReadVector<double>();
+        const auto spans      = reader.ReadVector<std::int32_t>();
+        if (name_ids.size() != item_types.size() || distances.size() != item_types.size() || spans.size() != item_types.size()) {
+            throw snapshot::FormatError ("Inconsistent edge items in snapshot");
+        }
+
+        edges_.resize (item_types.size());
+        bus_edge_ranges_.assign (catalogue.GetBuses ().size(), {});
+        for (size_t i = 0; i < edges_.size(); ++i) {
+            EdgeInfo& info = edges_[i];
+            info.type = ToEnum (item_types[i], ItemType::None);
+            if (info.type == ItemType::Wait) {
+                info.name = get_stop (name_ids[i])->stop_name;
+            } else if (info.type == ItemType::Bus) {
+                const domain::Bus* bus = catalogue.GetBusById (name_ids[i]);
+                if (!bus) {
+                    throw snapshot::FormatError ("Bus id is out of range in snapshot");
+                }
+                info.name = bus->bus_name;
+
+                EdgeRange& range = bus_edge_ranges_[bus->bus_id];
+                if (range.begin == range.end) {
+                    range.begin = i;
+                }
+                range.end = i + 1;
+            }
+            info.distance = distances[i];
+            info.span_count = spans[i];
+        }
+
+        const auto vertex_stop_ids = reader.ReadVector<std::uint32_t>();
+        vertex_stops_.reserve (vertex_stop_ids.size());
+        for (const std::uint32_t stop_id : vertex_stop_ids) {
+            vertex_stops_.push_back (stop_id == NO_STOP ? nullptr : get_stop (stop_id));
+        }
+
+        graph_ = std::make_unique<graph::CsrGraph<double>>(graph::CsrGraph<double>::Load (reader));
+        if (graph_ -> GetEdgeCount () != edges_.size() || graph_ -> GetVertexCount () != vertex_stops_.size()) {
+            throw snapshot::FormatError ("Router snapshot graph does not match its edge items");
+        }
+        graph_stats_.graph_memory_policy = graph_ -> ApplyMemoryPolicy (route_settings_.memory_policy);
+
+        switch (ReadEnum (reader, SnapshotEngine::Landmarks)) {
+            case SnapshotEngine::Table : {
+                router_ = std::make_unique<graph::Router<double>>(*graph_, graph::Router<double>::Table::Load (reader, route_settings_.memory_policy));
+                break;
+            }
+            case SnapshotEngine::FloatTable : {
+                router_ = std::make_unique<graph::Router<double, float>>(*graph_, graph::Router<double, float>::Table::Load (reader, route_settings_.memory_policy));
+                break;
+            }
+            case SnapshotEngine::ContractionHierarchy : {
+                router_ = std::make_unique<graph::ContractionHierarchy<double>>(*graph_, reader);
+                break;
+            }
+            case SnapshotEngine::Landmarks : {
+                router_ = std::make_unique<graph::AStarRouter<double>>(*graph_, MakeGeoHeuristic (), reader);
+                break;
+            }
+            case SnapshotEngine::None : {
+                CreateRouter ();
+                break;
+            }
+        }
+        UpdateMemoryStats (page_fault_count);
+}
+
+void TransportRouter::Save (snapshot::Writer& writer) const {
+    writer.WriteValue<std::int32_t>(route_settings_.bus_wait_time);
+    writer.WriteValue<double>(route_settings_.bus_velocity);
+    writer.WriteValue<std::uint8_t>(static_cast<std::uint8_t>(route_settings_.router_type));
+    writer.WriteValue<std::uint64_t>(route_settings_.thread_count);
+    writer.WriteValue<std::uint8_t>(route_settings_.use_float_weights);
+    writer.WriteValue<std::uint64_t>(route_settings_.landmark_count);
+    writer.WriteValue<std::uint8_t>(static_cast<std::uint8_t>(route_settings_.graph_model));
+    writer.WriteValue<std::uint64_t>(route_settings_.spt_cache_bytes);
+    writer.WriteValue<std::uint8_t>(static_cast<std::uint8_t>(route_settings_.vertex_order));
+    writer.WriteValue<std::uint8_t>(static_cast<std::uint8_t>(route_settings_.memory_policy.page_size));
+    writer.WriteValue<std::uint8_t>(static_cast<std::uint8_t>(route_settings_.memory_policy.numa_placement));
+    writer.WriteValue(graph_stats_);
+
+    writer.WriteVector (vertexes_);
+
+    std::vector<std::uint8_t>  item_types;
+    std::vector<std::uint32_t> name_ids;
+    std::vector<double>        distances;
+    std::vector<std::int32_t>  spans;
+    item_types.reserve (edges_.size());
+    name_ids.reserve (edges_.size());
+    distances.reserve (edges_.size());
+    spans.reserve (edges_.size());
+    for (const EdgeInfo& info : edges_) {
+        std::uint32_t name_id = 0;
+        if (info.type == ItemType::Wait) {
+            name_id = catalogue_.GetStopByName (info.name)->stop_id;
+        } else if (info.type == ItemType::Bus) {
+            name_id = catalogue_.GetBusByName (info.name)->bus_id;
+        }
+        item_types.push_back (static_cast<std::uint8_t>(info.type));
+        name_ids.push_back (name_id);
+        distances.push_back (info.distance);
+        spans.push_back (info.span_count);
+    }
+    writer.WriteVector (item_types);
+    writer.WriteVector (name_ids);
+    writer.WriteVector (distances);
+    writer.WriteVector (spans);
+
+    std::vector<std::uint32_t> vertex_stop_ids;
+    vertex_stop_ids.reserve (vertex_stops_.size());
+    for (const domain::Stop* stop : vertex_stops_) {
+        vertex_stop_ids.push_back (stop ? stop->stop_id : NO_STOP);
+    }
+    writer.WriteVector (vertex_stop_ids);
+
+    graph_ -> Save (writer);
+
+    if (const auto* router = dynamic_cast<const graph::Router<double>*>(router_.get())) {
+        writer.WriteValue (static_cast<std::uint8_t>(SnapshotEngine::Table));
+        router -> GetRoutesTable ().Save (writer);
+    } else if (const auto* float_router = dynamic_cast<const graph::Router<double, float>*>(router_.get())) {
+        writer.WriteValue (static_cast<std::uint8_t>(SnapshotEngine::FloatTable));
+        float_router -> GetRoutesTable ().Save (writer);
+    } else if (const auto* hierarchy = dynamic_cast<const graph::ContractionHierarchy<double>*>(router_.get())) {
+        writer.WriteValue (static_cast<std::uint8_t>(SnapshotEngine::ContractionHierarchy));
+        hierarchy -> Save (writer);
+    } else if (const auto* astar_router = dynamic_cast<const graph::AStarRouter<double>*>(router_.get())) {
+        writer.WriteValue (static_cast<std::uint8_t>(SnapshotEngine::Landmarks));
+        astar_router -> Save (writer);
+    } else {
+        writer.WriteValue (static_cast<std::uint8_t>(SnapshotEngine::None));
+    }
 }
 
 std::optional<TransportRouter::RouteItems> TransportRouter::GetRouteBetweenStops (std::string_view from_stop_name, std::string_view to_stop_name) const {
-    RouteItems items_info;
     auto stop_from   = catalogue_.GetStopByName (from_stop_name);
     auto stop_to     = catalogue_.GetStopByName (to_stop_name);
+    if (stop_from == nullptr || stop_to == nullptr) {
+        return std::nullopt;
+    }
     auto router_info = router_ -> BuildRoute (GetVertexByStop(stop_from).wait, GetVertexByStop(stop_to).wait);
 
     if (router_info.has_value()) {
-        items_info.total_time = router_info.value().weight;
-        
-        for (const auto& edge : router_info.value().edges) {
-            items_info.items.push_back (edges_.at(edge));
-        }
-        
-        return items_info;
+        return MakeRouteItems (router_info.value());
     } else {
         return std::nullopt;
     }
 }
 
+std::vector<std::optional<TransportRouter::RouteItems>> TransportRouter::GetRoutesFromStop (std::string_view from_stop_name, const std::vector<std::string_view>& to_stop_names) const {
+    std::vector<std::optional<RouteItems>> result (to_stop_names.size());
+    auto stop_from = catalogue_.GetStopByName (from_stop_name);
+    if (stop_from == nullptr) {
+        return result;
+    }
+
+    // Неизвестные остановки назначения остаются без маршрута
+    std::vector<size_t> target_indexes;
+    std::vector<graph::VertexId> targets;
+    for (size_t i = 0; i < to_stop_names.size(); ++i) {
+        if (auto stop_to = catalogue_.GetStopByName (to_stop_names[i])) {
+            target_indexes.push_back (i);
+            targets.push_back (GetVertexByStop(stop_to).wait);
+        }
+    }
+
+    auto routes = router_ -> BuildRoutes (GetVertexByStop(stop_from).wait, targets);
+    for (size_t i = 0; i < routes.size(); ++i) {
+        if (routes[i].has_value()) {
+            result[target_indexes[i]] = MakeRouteItems (routes[i].value());
+        }
+    }
+    return result;
+}
+
+std::vector<std::vector<std::optional<double>>> TransportRouter::GetTimeMatrix (const std::vector<std::string_view>& from_stop_names, const std::vector<std::string_view>& to_stop_names) const {
+    // Движок считает матрицу только по известным остановкам, строки и столбцы
+    // неизвестных остаются без маршрута
+    std::vector<size_t> from_indexes;
+    std::vector<size_t> to_indexes;
+    const auto sources = GetWaitVertexes (from_stop_names, from_indexes);
+    const auto targets = GetWaitVertexes (to_stop_names, to_indexes);
+
+    std::vector<std::vector<std::optional<double>>> result (from_stop_names.size(), std::vector<std::optional<double>>(to_stop_names.size()));
+    const auto matrix = router_ -> BuildWeightMatrix (sources, targets);
+    for (size_t i = 0; i < matrix.size(); ++i) {
+        for (size_t j = 0; j < matrix[i].size(); ++j) {
+            result[from_indexes[i]][to_indexes[j]] = matrix[i][j];
+        }
+    }
+    return result;
+}
+
+void TransportRouter::ForEachReachableStop (std::string_view stop_name, double max_time, const std::function<void(std::string_view stop_name, double time)>& on_stop) const {
+    auto stop = catalogue_.GetStopByName (stop_name);
+    if (stop == nullptr) {
+        return;
+    }
+
+    // Прибытие на остановку — вершина ожидания, остальные вершины промежуточные
+    graph::VisitVertexesWithinWeight (*graph_, GetVertexByStop(stop).wait, max_time, [&](graph::VertexId vertex, double time) {
+        const domain::Stop* vertex_stop = vertex_stops_[vertex];
+        if (GetVertexByStop (vertex_stop).wait == vertex) {
+            on_stop (vertex_stop->stop_name, time);
+        }
+    });
+}
+
+std::vector<graph::VertexId> TransportRouter::GetWaitVertexes (const std::vector<std::string_view>& stop_names, std::vector<size_t>& known_indexes) const {
+    std::vector<graph::VertexId> vertexes;
+    vertexes.reserve (stop_names.size());
+    known_indexes.clear ();
+    for (size_t i = 0; i < stop_names.size(); ++i) {
+        if (auto stop = catalogue_.GetStopByName (stop_names[i])) {
+            known_indexes.push_back (i);
+            vertexes.push_back (GetVertexByStop(stop).wait);
+        }
+    }
+    return vertexes;
+}
+
+TransportRouter::RouteItems TransportRouter::MakeRouteItems (const graph::RouterEngine<double>::RouteInfo& router_info) const {
+    RouteItems items_info;
+    items_info.total_time = router_info.weight;
+    items_info.items.reserve (router_info.edges.size());
+
+    for (const auto& edge : router_info.edges) {
+        const EdgeInfo& info = edges_[edge];
+        if (info.type == ItemType::None) {
+            continue;
+        }
+
+        Item item;
+        item.type = info.type;
+        item.name = info.name;
+        item.time = GetEdgeTime (info);
+        item.span_count = info.span_count;
+
+        // Перегоны одной поездки модели Line сливаются в одно действие Bus
+        if (!items_info.items.empty() && item.type == ItemType::Bus && items_info.items.back().type == ItemType::Bus
+            && items_info.items.back().name == item.name) {
+            items_info.items.back().time += item.time;
+            items_info.items.back().span_count += item.span_count;
+        } else {
+            items_info.items.push_back (item);
+        }
+    }
+    return items_info;
+}
+
 void TransportRouter::AddAllStopsToGraph () {
-    using namespace std::literals;
     graph::VertexId vertex_id = 0;
+    vertexes_.resize (catalogue_.GetStops ().size());
 
-    // for (const auto& [stop_name, stop] : catalogue_.GetStopDir ()) {
-    for (const auto& [stop_name, stop] : catalogue_.GetStopDirectory ()) {
-        vertexes_[stop] = {vertex_id, vertex_id + 1};
-        auto edge_id = graph_ -> AddEdge ({vertex_id, vertex_id + 1, static_cast<double>(route_settings_.bus_wait_time)});
+    for (const domain::Stop& stop : catalogue_.GetStops ()) {
+        vertexes_[stop.stop_id] = {vertex_id, vertex_id + 1};
+        vertex_stops_[vertex_id]     = &stop;
+        vertex_stops_[vertex_id + 1] = &stop;
 
-        Item item;
-        item.type = "Wait"s;
-        item.name = stop_name;
-        item.time = static_cast<double>(route_settings_.bus_wait_time);
-        item.span_count = 1;
+        EdgeInfo info;
+        info.type = ItemType::Wait;
+        info.name = stop.stop_name;
+        info.span_count = 1;
 
-        edges_[edge_id] = std::move (item);
+        AddEdge (vertex_id, vertex_id + 1, info);
         vertex_id += 2;
     }
 }
 
-StopVertex TransportRouter::GetVertexByStop (domain::Stop* stop) const {
-    return vertexes_.at(stop);
+EngineStats TransportRouter::GetEngineStats () const {
+    const auto search_stats = router_ -> GetSearchStats ();
+    EngineStats stats;
+    stats.query_count   = search_stats.query_count;
+    stats.settled_count = search_stats.settled_count;
+    if (const auto* hierarchy = dynamic_cast<const graph::ContractionHierarchy<double>*>(router_.get())) {
+        stats.shortcut_count = hierarchy -> GetShortcutCount ();
+    } else if (const auto* astar = dynamic_cast<const graph::AStarRouter<double>*>(router_.get())) {
+        stats.landmark_count = astar -> GetLandmarks ().size();
+    } else if (const auto* dijkstra = dynamic_cast<const graph::DijkstraRouter<double>*>(router_.get())) {
+        const auto cache_stats = dijkstra -> GetCacheStats ();
+        stats.cache_hit_count      = cache_stats.hit_count;
+        stats.cache_miss_count     = cache_stats.miss_count;
+        stats.cache_eviction_count = cache_stats.eviction_count;
+        stats.cache_byte_size      = cache_stats.byte_size;
+    }
+    return stats;
+}
+
+const GraphStats& TransportRouter::GetGraphStats () const {
+    return graph_stats_;
+}
+
+const RouteSettings& TransportRouter::GetSettings () const {
+    return route_settings_;
+}
+
+const UpdateStats& TransportRouter::GetUpdateStats () const {
+    return update_stats_;
+}
+
+UpdateStats& UpdateStats::operator+= (const UpdateStats& other) {
+    changed_edge_count += other.changed_edge_count;
+    repaired_count     += other.repaired_count;
+    settled_count      += other.settled_count;
+    repair_time_ms     += other.repair_time_ms;
+    update_count       += other.update_count;
+    return *this;
 }
 
-void TransportRouter::AddBusEdge (domain::Stop* stop_from, domain::Stop* stop_to, std::string_view bus_name, int span, double distance) {
-    using namespace std::literals;
+UpdateStats TransportRouter::UpdateBusEdges (std::string_view bus_name) {
+    const domain::Bus* bus = catalogue_.GetBusByName (bus_name);
+    if (!bus) {
+        throw std::invalid_argument ("Unknown bus: " + std::string (bus_name));
+    }
+
+    // Новые расстояния поездок в том же порядке, в каком рёбра автобуса добавлялись в граф
+    std::vector<double> distances;
+    switch (route_settings_.graph_model) {
+        case GraphModel::Span : {
+            std::vector<BusEdge> bus_edges;
+            MakeBusEdges (*bus, bus_edges);
+            for (const auto& bus_edge : bus_edges) {
+                distances.push_back (bus_edge.info.distance);
+            }
+            break;
+        }
+        case GraphModel::Line : {
+            const auto& stops = bus->stop_ids;
+            for (size_t i = 0; i + 1 < stops.size(); ++i) {
+                distances.push_back (static_cast<double>(catalogue_.GetDistBetweenStops (stops[i], stops[i + 1])));
+            }
+            if (!bus->is_roundtrip) {
+                for (size_t i = stops.size() - 1; i > 0; --i) {
+                    distances.push_back (static_cast<double>(catalogue_.GetDistBetweenStops (stops[i], stops[i - 1])));
+                }
+            }
+            break;
+        }
+    }
 
+    // Движку передаются только рёбра, расстояние которых изменилось
+    std::vector<graph::EdgeId> changed_edges;
+    size_t bus_edge_index = 0;
+    const EdgeRange& range = bus_edge_ranges_[bus->bus_id];
+    for (graph::EdgeId edge_id = range.begin; edge_id < range.end; ++edge_id) {
+        EdgeInfo& info = edges_[edge_id];
+        if (info.type != ItemType::Bus || info.name != bus->bus_name) {
+            continue;
+        }
+        if (bus_edge_index == distances.size()) {
+            throw std::logic_error ("Bus edges do not match the bus route");
+        }
+        const double distance = distances[bus_edge_index++];
+        if (info.distance != distance) {
+            info.distance = distance;
+            changed_edges.push_back (edge_id);
+        }
+    }
+    if (bus_edge_index != distances.size()) {
+        throw std::logic_error ("Bus edges do not match the bus route");
+    }
+    return UpdateGraphWeights (changed_edges);
+}
+
+UpdateStats TransportRouter::Recustomize (int bus_wait_time, double bus_velocity) {
+    route_settings_.bus_wait_time = bus_wait_time;
+    route_settings_.bus_velocity  = bus_velocity;
+
+    std::vector<graph::EdgeId> changed_edges;
+    for (graph::EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        if (graph_ -> GetEdge (edge_id).weight != GetEdgeTime (edges_[edge_id])) {
+            changed_edges.push_back (edge_id);
+        }
+    }
+    return UpdateGraphWeights (changed_edges);
+}
+
+UpdateStats TransportRouter::UpdateGraphWeights (const std::vector<graph::EdgeId>& edge_ids) {
+    const auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<graph::RouterEngine<double>::EdgeWeightChange> changes;
+    changes.reserve (edge_ids.size());
+    for (const graph::EdgeId edge_id : edge_ids) {
+        const double weight = GetEdgeTime (edges_[edge_id]);
+        if (graph_ -> GetEdge (edge_id).weight != weight) {
+            changes.push_back ({edge_id, graph_ -> GetEdge (edge_id).weight});
+            graph_ -> SetEdgeWeight (edge_id, weight);
+        }
+    }
+
+    UpdateStats stats;
+    stats.changed_edge_count = changes.size();
+    // Оценка по координатам зависит от настроек и расстояний каталога и строится заново,
+    // ориентиры движок чинит сам
+    if (auto* astar_router = dynamic_cast<graph::AStarRouter<double>*>(router_.get())) {
+        astar_router -> SetHeuristic (MakeGeoHeuristic ());
+    }
+    const auto repair_stats = router_ -> RepairAfterWeightChanges (changes);
+    stats.repaired_count = repair_stats.repaired_count;
+    stats.settled_count  = repair_stats.settled_count;
+    stats.repair_time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    stats.update_count = 1;
+    update_stats_ += stats;
+    return stats;
+}
+
+StopVertex TransportRouter::GetVertexByStop (const domain::Stop* stop) const {
+    return vertexes_[stop->stop_id];
+}
+
+void TransportRouter::AddEdge (graph::VertexId from, graph::VertexId to, const EdgeInfo& info) {
+    graph_builder_ -> AddEdge ({from, to, GetEdgeTime (info)});
+    edges_.push_back (info);
+}
+
+double TransportRouter::GetRideTime (double distance) const {
     const double conv_meter_per_min = 1000. / 60.;
+    return distance / (route_settings_.bus_velocity * conv_meter_per_min);
+}
+
+double TransportRouter::GetEdgeTime (const EdgeInfo& info) const {
+    switch (info.type) {
+        case ItemType::Wait :
+            return static_cast<double>(route_settings_.bus_wait_time);
+        case ItemType::Bus :
+            return GetRideTime (info.distance);
+        case ItemType::None :
+            break;
+    }
+    return 0.0;
+}
+
+TransportRouter::BusEdge TransportRouter::MakeBusEdge (domain::StopId stop_from, domain::StopId stop_to, std::string_view bus_name, int span, double distance) const {
+    EdgeInfo info;
+    info.type = ItemType::Bus;
+    info.name = bus_name;
+    info.distance = distance;
+    info.span_count = span;
+
+    auto vertex_from = vertexes_[stop_from];
+    auto vertex_to   = vertexes_[stop_to];
+
+    return {vertex_from.bus, vertex_to.wait, info};
+}
+
+void TransportRouter::MakeBusEdges (const domain::Bus& bus, std::vector<BusEdge>& bus_edges) const {
+    const auto& stops = bus.stop_ids;
 
-    Item item;
-    item.type = "Bus"s;
-    item.name = bus_name;
-    item.time = distance / (route_settings_.bus_velocity * conv_meter_per_min);
-    item.span_count = span;
+    for (size_t i = 0; i + 1 < stops.size(); ++i) {
+        double forward_dist  = 0.0;
+        double backward_dist = 0.0;
 
-    auto vertex_from = GetVertexByStop(stop_from);
-    auto vertex_to   = GetVertexByStop(stop_to);
-    
-    auto edge_id     = graph_ -> AddEdge ({vertex_from.bus, vertex_to.wait, item.time});
+        for (size_t j = i; j + 1 < stops.size(); ++j) {
+            forward_dist += static_cast<double>(catalogue_.GetDistBetweenStops(stops[j], stops[j + 1]));
+            bus_edges.push_back (MakeBusEdge (stops[i], stops[j + 1], bus.bus_name, static_cast<int>(j - i + 1), forward_dist));
 
-    edges_[edge_id]  = std::move (item);    
+            if (!bus.is_roundtrip) {
+                backward_dist += static_cast<double>(catalogue_.GetDistBetweenStops(stops[j + 1], stops[j]));
+                bus_edges.push_back (MakeBusEdge (stops[j + 1], stops[i], bus.bus_name, static_cast<int>(j - i + 1), backward_dist));
+            }
+        }
+    }
 }
 
+// Рёбра каждого автобуса строятся независимо в свой буфер, а затем добавляются
+// в граф в порядке справочника автобусов, поэтому EdgeId не зависят от числа потоков
 void TransportRouter::AddRouteToGraph () {
-    for (const auto& [bus_name, bus] : catalogue_.GetBusDirectory ()){
-        for (size_t i = 0; i < bus->stops_for_bus.size() - 1; ++i) {
-            double forward_dist  = 0.0;
-            double backward_dist = 0.0;
-        
-            for (size_t j = i; j < bus->stops_for_bus.size() - 1; ++j) {
-                forward_dist += static_cast<double>(catalogue_.GetDistBetweenStops(bus->stops_for_bus[j], bus->stops_for_bus[j + 1]));
-                AddBusEdge (bus->stops_for_bus[i], bus->stops_for_bus[j + 1], bus_name, static_cast<int>(j - i + 1), forward_dist);
-                
-                if (!bus->is_roundtrip) {
-                    backward_dist += static_cast<double>(catalogue_.GetDistBetweenStops(bus->stops_for_bus[j + 1], bus->stops_for_bus[j]));
-                    AddBusEdge (bus->stops_for_bus[j + 1], bus->stops_for_bus[i], bus_name,  static_cast<int>(j - i + 1), backward_dist);
-                }
-            }        
+    const std::vector<const domain::Bus*> buses = catalogue_.GetBusesByName ();
+
+    std::vector<std::vector<BusEdge>> bus_edges (buses.size());
+    parallel::ThreadPool pool (route_settings_.thread_count);
+    pool.ParallelFor (buses.size(), [&](size_t bus_index) {
+        MakeBusEdges (*buses[bus_index], bus_edges[bus_index]);
+    });
+
+    size_t edge_count = edges_.size();
+    for (const auto& edges : bus_edges) {
+        edge_count += edges.size();
+    }
+    edges_.reserve (edge_count);
+
+    for (size_t bus_index = 0; bus_index < buses.size(); ++bus_index) {
+        EdgeRange& range = bus_edge_ranges_[buses[bus_index]->bus_id];
+        range.begin = edges_.size();
+        for (const auto& [from, to, info] : bus_edges[bus_index]) {
+            AddEdge (from, to, info);
+        }
+        range.end = edges_.size();
+        bus_edges[bus_index] = {};
+    }
+}
+
+size_t TransportRouter::CountLineVertexes () const {
+    size_t line_vertex_count = 0;
+    for (const domain::Bus* bus : catalogue_.GetBusesByName ()) {
+        line_vertex_count += bus->is_roundtrip ? bus->stop_ids.size() : bus->stop_ids.size() * 2;
+    }
+    return line_vertex_count;
+}
+
+// Вершины «в автобусе» ride_i цепочкой по остановкам stops:
+//   посадка    bus(stop_i) -> ride_i,       вес 0 (ожидание — на ребре wait -> bus остановки)
+//   перегон    ride_i      -> ride_(i + 1), вес — время в пути, действие Bus с span_count = 1
+//   высадка    ride_i      -> wait(stop_i), вес 0, без действия
+void TransportRouter::AddLineToGraph (const domain::Bus& bus, const std::vector<domain::StopId>& stops, graph::VertexId& vertex_id) {
+    const graph::VertexId first_ride = vertex_id;
+
+    for (size_t i = 0; i < stops.size(); ++i) {
+        const graph::VertexId ride = first_ride + i;
+        const StopVertex stop_vertex = vertexes_[stops[i]];
+        vertex_stops_[ride] = &catalogue_.GetStops ()[stops[i]];
+
+        if (i + 1 < stops.size()) {
+            AddEdge (stop_vertex.bus, ride, {});
+
+            EdgeInfo info;
+            info.type = ItemType::Bus;
+            info.name = bus.bus_name;
+            info.distance = static_cast<double>(catalogue_.GetDistBetweenStops (stops[i], stops[i + 1]));
+            info.span_count = 1;
+
+            AddEdge (ride, ride + 1, info);
+        }
+        if (i > 0) {
+            AddEdge (ride, stop_vertex.wait, {});
+        }
+    }
+    vertex_id += stops.size();
+}
+
+void TransportRouter::AddLinesToGraph () {
+    graph::VertexId vertex_id = catalogue_.GetStops ().size() * 2;
+
+    for (const domain::Bus* bus : catalogue_.GetBusesByName ()) {
+        EdgeRange& range = bus_edge_ranges_[bus->bus_id];
+        range.begin = edges_.size();
+        AddLineToGraph (*bus, bus->stop_ids, vertex_id);
+
+        if (!bus->is_roundtrip) {
+            std::vector<domain::StopId> backward_stops (bus->stop_ids.rbegin(), bus->stop_ids.rend());
+            AddLineToGraph (*bus, backward_stops, vertex_id);
+        }
+        range.end = edges_.size();
+    }
+}
+
+// Новые номера вершин по индексу Гильберта их остановок; вершины одной остановки
+// (ожидание, посадка, «в автобусе») остаются рядом в прежнем относительном порядке.
+// EdgeId не меняются, поэтому данные рёбер edges_ остаются на своих местах
+void TransportRouter::ReorderVertexes () {
+    const size_t vertex_count = graph_builder_ -> GetVertexCount ();
+
+    double min_lat = std::numeric_limits<double>::max();
+    double min_lng = std::numeric_limits<double>::max();
+    double max_lat = std::numeric_limits<double>::lowest();
+    double max_lng = std::numeric_limits<double>::lowest();
+    for (const domain::Stop& stop : catalogue_.GetStops ()) {
+        min_lat = std::min (min_lat, stop.stop_coord.lat);
+        max_lat = std::max (max_lat, stop.stop_coord.lat);
+        min_lng = std::min (min_lng, stop.stop_coord.lng);
+        max_lng = std::max (max_lng, stop.stop_coord.lng);
+    }
+
+    const auto to_cell = [](double value, double min_value, double max_value) {
+        if (!(max_value > min_value)) {
+            return std::uint32_t{0};
         }
+        return static_cast<std::uint32_t>((value - min_value) / (max_value - min_value) * HILBERT_MAX_CELL);
+    };
+
+    std::vector<std::uint64_t> stop_keys (vertexes_.size());
+    for (const domain::Stop& stop : catalogue_.GetStops ()) {
+        stop_keys[stop.stop_id] = ComputeHilbertIndex (to_cell (stop.stop_coord.lng, min_lng, max_lng),
+                                                       to_cell (stop.stop_coord.lat, min_lat, max_lat));
+    }
+
+    // Пара (индекс, прежний номер) уникальна, прежний номер упорядочивает вершины одной остановки
+    std::vector<std::pair<std::uint64_t, graph::VertexId>> order (vertex_count);
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order[vertex] = {stop_keys[vertex_stops_[vertex]->stop_id], vertex};
+    }
+    std::sort (order.begin(), order.end());
+
+    std::vector<graph::VertexId> new_ids (vertex_count);
+    std::vector<const domain::Stop*> vertex_stops (vertex_count);
+    for (graph::VertexId new_id = 0; new_id < vertex_count; ++new_id) {
+        new_ids[order[new_id].second] = new_id;
+        vertex_stops[new_id] = vertex_stops_[order[new_id].second];
+    }
+    vertex_stops_ = std::move (vertex_stops);
+    for (StopVertex& stop_vertex : vertexes_) {
+        stop_vertex = {new_ids[stop_vertex.wait], new_ids[stop_vertex.bus]};
+    }
+
+    auto graph = std::make_unique<graph::DirectedWeightedGraph<double>>(vertex_count);
+    for (graph::EdgeId edge_id = 0; edge_id < graph_builder_ -> GetEdgeCount (); ++edge_id) {
+        const auto& edge = graph_builder_ -> GetEdge (edge_id);
+        graph -> AddEdge ({new_ids[edge.from], new_ids[edge.to], edge.weight});
     }
+    graph_builder_ = std::move (graph);
 }
 
 void TransportRouter::BuildAllRoutes () {
-    size_t all_stops_count = catalogue_.GetStopDirectory ().size();
+    const auto start_time = std::chrono::steady_clock::now();
+    size_t vertex_count = catalogue_.GetStops ().size() * 2;
+    if (route_settings_.graph_model == GraphModel::Line) {
+        vertex_count += CountLineVertexes ();
+    }
 
-    graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(all_stops_count * 2);
+    graph_builder_ = std::make_unique<graph::DirectedWeightedGraph<double>>(vertex_count);
+    vertex_stops_.assign (vertex_count, nullptr);
+    bus_edge_ranges_.assign (catalogue_.GetBuses ().size(), {});
     AddAllStopsToGraph ();
-    AddRouteToGraph ();
-    router_ = std::make_unique<graph::Router<double>>(*graph_);
+
+    switch (route_settings_.graph_model) {
+        case GraphModel::Span : {
+            AddRouteToGraph ();
+            break;
+        }
+        case GraphModel::Line : {
+            AddLinesToGraph ();
+            break;
+        }
+    }
+
+    if (route_settings_.vertex_order == VertexOrder::Hilbert) {
+        ReorderVertexes ();
+    }
+
+    // Движки обходят замороженный CSR-граф, списки смежности построителя больше не нужны
+    graph_ = std::make_unique<graph::CsrGraph<double>>(*graph_builder_);
+    graph_builder_.reset();
+    graph_stats_.graph_memory_policy = graph_ -> ApplyMemoryPolicy (route_settings_.memory_policy);
+
+    graph_stats_.vertex_count  = graph_ -> GetVertexCount ();
+    graph_stats_.edge_count    = graph_ -> GetEdgeCount ();
+    graph_stats_.build_time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+    CreateRouter ();
+}
+
+graph::AStarRouter<double>::Heuristic TransportRouter::MakeGeoHeuristic () const {
+    // Оценка допустима, если дорожное расстояние не меньше геодезического, умноженного
+    // на road_to_geo — минимальное отношение этих расстояний по всем перегонам
+    double road_to_geo = std::numeric_limits<double>::max();
+
+    const auto& stops = catalogue_.GetStops ();
+    for (const domain::Bus& bus : catalogue_.GetBuses ()) {
+        for (size_t i = 0; i + 1 < bus.stop_ids.size(); ++i) {
+            const domain::Stop* stop_from = &stops[bus.stop_ids[i]];
+            const domain::Stop* stop_to   = &stops[bus.stop_ids[i + 1]];
+            const double geo_dist = geo::ComputeDistance (stop_from->stop_coord, stop_to->stop_coord);
+
+            if (geo_dist > 0.0) {
+                road_to_geo = std::min (road_to_geo, catalogue_.GetDistBetweenStops (stop_from, stop_to) / geo_dist);
+                if (!bus.is_roundtrip) {
+                    road_to_geo = std::min (road_to_geo, catalogue_.GetDistBetweenStops (stop_to, stop_from) / geo_dist);
+                }
+            }
+        }
+    }
+    if (road_to_geo == std::numeric_limits<double>::max()) {
+        road_to_geo = 0.0;
+    }
+
+    // Запас на погрешность вычислений, чтобы оценка не превысила точный вес
+    const double conv_meter_per_min = 1000. / 60.;
+    const double min_per_meter = road_to_geo * (1.0 - 1e-9) / (route_settings_.bus_velocity * conv_meter_per_min);
+    const double wait_time = static_cast<double>(route_settings_.bus_wait_time);
+
+    std::vector<bool> is_wait_vertex (graph_ -> GetVertexCount(), false);
+    for (const StopVertex& vertex : vertexes_) {
+        is_wait_vertex[vertex.wait] = true;
+    }
+
+    // Из вершины ожидания другой остановки не уехать, не подождав автобус
+    return [vertex_stops = vertex_stops_, is_wait_vertex = std::move (is_wait_vertex), min_per_meter, wait_time]
+           (graph::VertexId vertex, graph::VertexId target) {
+        const domain::Stop* stop_from = vertex_stops[vertex];
+        const domain::Stop* stop_to   = vertex_stops[target];
+        if (stop_from == stop_to) {
+            return 0.0;
+        }
+        const double ride_time = geo::ComputeDistance (stop_from->stop_coord, stop_to->stop_coord) * min_per_meter;
+        return is_wait_vertex[vertex] ? ride_time + wait_time : ride_time;
+    };
+}
+
+void TransportRouter::CreateRouter () {
+    const bool is_all_pairs = route_settings_.router_type == RouterType::AllPairs || route_settings_.router_type == RouterType::AllPairsTiled;
+    if (is_all_pairs && !route_settings_.table_file.empty()) {
+        if (route_settings_.use_float_weights) {
+            router_ = std::make_unique<graph::Router<double, float>>(*graph_, route_settings_.table_file, route_settings_.thread_count);
+        } else {
+            router_ = std::make_unique<graph::Router<double>>(*graph_, route_settings_.table_file, route_settings_.thread_count);
+        }
+        return;
+    }
+
+    switch (route_settings_.router_type) {
+        case RouterType::AllPairs : {
+            if (route_settings_.use_float_weights) {
+                router_ = std::make_unique<graph::Router<double, float>>(*graph_, route_settings_.memory_policy);
+            } else {
+                router_ = std::make_unique<graph::Router<double>>(*graph_, route_settings_.memory_policy);
+            }
+            break;
+        }
+        case RouterType::AllPairsTiled : {
+            if (route_settings_.use_float_weights) {
+                router_ = std::make_unique<graph::Router<double, float>>(*graph_, route_settings_.thread_count, route_settings_.memory_policy);
+            } else {
+                router_ = std::make_unique<graph::Router<double>>(*graph_, route_settings_.thread_count, route_settings_.memory_policy);
+            }
+            break;
+        }
+        case RouterType::Dijkstra : {
+            router_ = std::make_unique<graph::DijkstraRouter<double>>(*graph_, route_settings_.spt_cache_bytes);
+            break;
+        }
+        case RouterType::ContractionHierarchy : {
+            router_ = std::make_unique<graph::ContractionHierarchy<double>>(*graph_);
+            break;
+        }
+        case RouterType::AStar : {
+            router_ = std::make_unique<graph::AStarRouter<double>>(*graph_, MakeGeoHeuristic (), route_settings_.landmark_count);
+            break;
+        }
+    }
+}
+
+void TransportRouter::UpdateMemoryStats (size_t page_fault_count_before) {
+    graph_stats_.table_memory_policy = {};
+    if (const auto* router = dynamic_cast<const graph::Router<double>*>(router_.get())) {
+        graph_stats_.table_memory_policy = router -> GetRoutesTable ().GetMemoryPolicy ();
+    } else if (const auto* float_router = dynamic_cast<const graph::Router<double, float>*>(router_.get())) {
+        graph_stats_.table_memory_policy = float_router -> GetRoutesTable ().GetMemoryPolicy ();
+    }
+    graph_stats_.page_fault_count = storage::GetPageFaultCount () - page_fault_count_before;
 }
 
 } // namespace transport_router
@@ -1,14 +1,24 @@
 #pragma once
 
-#include <map>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "astar_router.h"
+#include "contraction_hierarchy.h"
+#include "csr_graph.h"
+#include "dijkstra_router.h"
 #include "domain.h"
 #include "graph.h"
+#include "mapped_file.h"
 #include "router.h"
+#include "router_engine.h"
+#include "snapshot.h"
+#include "thread_pool.h"
 #include "transport_catalogue.h"
 
 namespace transport_router {
@@ -18,16 +28,114 @@ struct StopVertex {
     graph::VertexId bus;
 };
 
+// Движок поиска маршрутов
+enum class RouterType {
+    // Предрасчёт таблицы маршрутов между всеми парами вершин, O(1) на запрос
+    AllPairs,
+    // То же, но блочный Флойд–Уоршелл на thread_count потоках
+    AllPairsTiled,
+    // Алгоритм Дейкстры на каждый запрос, построение линейно по размеру графа
+    Dijkstra,
+    // Иерархия сжатий: предрасчёт сокращений и двунаправленный поиск вверх
+    ContractionHierarchy,
+    // A* с оценкой по координатам остановок и, опционально, ориентирам ALT
+    AStar
+};
+
+// Модель графа маршрутов
+enum class GraphModel {
+    // Ребро между каждой парой остановок автобуса, O(k²) рёбер на маршрут
+    Span,
+    // Цепочка вершин «в автобусе» по остановкам маршрута, O(k) рёбер на маршрут
+    Line
+};
+
+// Нумерация вершин графа
+enum class VertexOrder {
+    // В порядке номеров остановок (StopId)
+    Directory,
+    // По кривой Гильберта на координатах остановок: близкие остановки получают
+    // близкие номера, и поиск обращается к соседним участкам памяти
+    Hilbert
+};
+
 struct RouteSettings {
     int bus_wait_time = 0;
     double bus_velocity = 0.0;
+    RouterType router_type = RouterType::AllPairs;
+    // Число потоков построения графа и предрасчёта, 0 — по числу ядер
+    size_t thread_count = 0;
+    // Хранить таблицу всех пар во float (только для AllPairs / AllPairsTiled)
+    bool use_float_weights = false;
+    // Число ориентиров ALT для AStar, 0 — только оценка по координатам
+    size_t landmark_count = 0;
+    GraphModel graph_model = GraphModel::Span;
+    // Бюджет кэша деревьев кратчайших путей для Dijkstra, байт; 0 — без кэша
+    size_t spt_cache_bytes = 0;
+    // Файл для таблицы всех пар, если она не помещается в ОЗУ (AllPairs / AllPairsTiled);
+    // пусто — таблица в памяти
+    std::string table_file;
+    VertexOrder vertex_order = VertexOrder::Directory;
+    // Размещение массивов графа и таблицы всех пар в памяти (кроме table_file)
+    storage::MemoryPolicy memory_policy;
+};
+
+struct GraphStats {
+    size_t vertex_count = 0;
+    size_t edge_count = 0;
+    // Время построения графа (без предрасчёта движка), мс
+    double build_time_ms = 0.0;
+    // Политики, которые удалось применить к массивам графа и к таблице всех пар
+    storage::MemoryPolicy graph_memory_policy;
+    storage::MemoryPolicy table_memory_policy;
+    // Отказы страниц за построение или загрузку маршрутизатора
+    size_t page_fault_count = 0;
+};
+
+// Работа движка с его построения или загрузки
+struct EngineStats {
+    // Поиски по запросу и обработанные ими вершины (Dijkstra и AStar)
+    size_t query_count = 0;
+    size_t settled_count = 0;
+    // Сокращения иерархии (ContractionHierarchy)
+    size_t shortcut_count = 0;
+    // Ориентиры ALT (AStar)
+    size_t landmark_count = 0;
+    // Кэш деревьев кратчайших путей (Dijkstra с spt_cache_bytes)
+    size_t cache_hit_count = 0;
+    size_t cache_miss_count = 0;
+    size_t cache_eviction_count = 0;
+    size_t cache_byte_size = 0;
+};
+
+// Объём работы по обновлению весов рёбер
+struct UpdateStats {
+    size_t changed_edge_count = 0;
+    // Пересчитанные части предрасчёта: строки таблицы всех пар, сжатые вершины
+    // иерархии или ориентиры ALT
+    size_t repaired_count = 0;
+    // Вершины, обработанные поисками при починке
+    size_t settled_count = 0;
+    double repair_time_ms = 0.0;
+    // Число обновлений, сложенных в эту статистику
+    size_t update_count = 0;
+
+    UpdateStats& operator+= (const UpdateStats& other);
+};
+
+enum class ItemType {
+    Wait,
+    Bus,
+    // Ребро без действия пассажира (посадка и высадка модели Line)
+    None
 };
 
 class TransportRouter {
 public:
+    // name указывает на имя остановки (Wait) или автобуса (Bus) в каталоге
     struct Item {
-        std::string type;
-        std::string name;
+        ItemType type = ItemType::None;
+        std::string_view name;
         double time = 0.0;
         int span_count = 0;
     };
@@ -40,21 +148,108 @@ public:
     TransportRouter () = default;
     TransportRouter (const trans_cat::TransportCatalogue& catalogue, const RouteSettings& settings);
 
+    // Восстановление из снимка без построения графа и предрасчёта; catalogue загружен
+    // из того же снимка. Таблица всех пар берётся из отображения снимка, иерархия
+    // сжатий и расстояния до ориентиров ALT читаются из него же
+    TransportRouter (const trans_cat::TransportCatalogue& catalogue, snapshot::Reader& reader);
+
+    // Настройки, граф, действия по рёбрам и предрасчёт движка: таблица всех пар
+    // (построенная в table_file тоже копируется в снимок, файл после make_base
+    // не нужен), иерархия сжатий или ориентиры ALT
+    void Save (snapshot::Writer& writer) const;
+
     std::optional<RouteItems> GetRouteBetweenStops (std::string_view from_stop_name, std::string_view to_stop_name) const;
 
+    // Маршруты из одной остановки во все to_stop_names (ответы в том же порядке).
+    // Для неизвестных остановок маршрута нет
+    std::vector<std::optional<RouteItems>> GetRoutesFromStop (std::string_view from_stop_name, const std::vector<std::string_view>& to_stop_names) const;
+
+    // Матрица времён в пути from_stop_names x to_stop_names, nullopt — маршрута нет
+    // (в том числе для неизвестных остановок)
+    std::vector<std::vector<std::optional<double>>> GetTimeMatrix (const std::vector<std::string_view>& from_stop_names, const std::vector<std::string_view>& to_stop_names) const;
+
+    // Вызывает on_stop для каждой остановки, до которой из stop_name можно доехать
+    // не дольше max_time минут, в порядке возрастания времени (сама остановка — с нулём,
+    // если max_time не отрицателен).
+    // Для неизвестной остановки не вызывается ни разу
+    void ForEachReachableStop (std::string_view stop_name, double max_time, const std::function<void(std::string_view stop_name, double time)>& on_stop) const;
+
+    EngineStats GetEngineStats () const;
+
+    const GraphStats& GetGraphStats () const;
+
+    const RouteSettings& GetSettings () const;
+
+    // Сумма статистик всех UpdateBusEdges и Recustomize с построения или загрузки
+    const UpdateStats& GetUpdateStats () const;
+
+    // Пересчитывает время поездок автобуса bus_name по текущим расстояниям каталога
+    // (после SetDistBetweenStops) и чинит только затронутый предрасчёт движка
+    UpdateStats UpdateBusEdges (std::string_view bus_name);
+
+    // Новые время ожидания и скорость без перестроения графа: веса рёбер
+    // пересчитываются из расстояний, движок повторяет только предрасчёт, зависящий от весов
+    UpdateStats Recustomize (int bus_wait_time, double bus_velocity);
+
 private:
     RouteSettings route_settings_;
     const trans_cat::TransportCatalogue& catalogue_;
-    std::unique_ptr<graph::DirectedWeightedGraph<double>> graph_;
-    std::unique_ptr<graph::Router<double>> router_;
-    std::map<domain::Stop*, StopVertex> vertexes_;
-    std::map<graph::EdgeId, Item> edges_;
+    std::unique_ptr<graph::DirectedWeightedGraph<double>> graph_builder_;
+    std::unique_ptr<graph::CsrGraph<double>> graph_;
+    std::unique_ptr<graph::RouterEngine<double>> router_;
+    // Ребро графа: действие пассажира и исходные данные его веса. Время считается
+    // из настроек (GetEdgeTime), поэтому их смена не требует перестроения графа
+    struct EdgeInfo {
+        ItemType type = ItemType::None;
+        std::string_view name;
+        // Дорожное расстояние поездки (Bus), м
+        double distance = 0.0;
+        int span_count = 0;
+    };
+
+    // Вершины остановок по stop_id и рёбра по EdgeId
+    std::vector<StopVertex> vertexes_;
+    std::vector<EdgeInfo> edges_;
+    // Рёбра автобуса идут в графе подряд: [begin, end) по bus_id. В модели Line
+    // в отрезок попадают и рёбра посадки и высадки без действия
+    struct EdgeRange {
+        graph::EdgeId begin = 0;
+        graph::EdgeId end = 0;
+    };
+    std::vector<EdgeRange> bus_edge_ranges_;
+    // Остановка каждой вершины графа, включая вершины «в автобусе» модели Line
+    std::vector<const domain::Stop*> vertex_stops_;
+    GraphStats graph_stats_;
+    UpdateStats update_stats_;
 
     void AddAllStopsToGraph ();
-    StopVertex GetVertexByStop (domain::Stop* stop) const;
-    void AddBusEdge (domain::Stop* stop_from, domain::Stop* stop_to, std::string_view bus_name, int span, double distance);
+    StopVertex GetVertexByStop (const domain::Stop* stop) const;
+    // Вершины ожидания известных остановок из stop_names, их позиции — в known_indexes
+    std::vector<graph::VertexId> GetWaitVertexes (const std::vector<std::string_view>& stop_names, std::vector<size_t>& known_indexes) const;
+    RouteItems MakeRouteItems (const graph::RouterEngine<double>::RouteInfo& router_info) const;
+    void AddEdge (graph::VertexId from, graph::VertexId to, const EdgeInfo& info);
+    struct BusEdge {
+        graph::VertexId from;
+        graph::VertexId to;
+        EdgeInfo info;
+    };
+
+    double GetRideTime (double distance) const;
+    double GetEdgeTime (const EdgeInfo& info) const;
+    // Записывает в граф веса рёбер edge_ids по текущим настройкам и чинит движок
+    UpdateStats UpdateGraphWeights (const std::vector<graph::EdgeId>& edge_ids);
+    BusEdge MakeBusEdge (domain::StopId stop_from, domain::StopId stop_to, std::string_view bus_name, int span, double distance) const;
+    void MakeBusEdges (const domain::Bus& bus, std::vector<BusEdge>& bus_edges) const;
     void AddRouteToGraph ();
+    size_t CountLineVertexes () const;
+    void AddLineToGraph (const domain::Bus& bus, const std::vector<domain::StopId>& stops, graph::VertexId& vertex_id);
+    void AddLinesToGraph ();
+    void ReorderVertexes ();
+    graph::AStarRouter<double>::Heuristic MakeGeoHeuristic () const;
+    void CreateRouter ();
     void BuildAllRoutes ();
+    // Применённые политики размещения и отказы страниц с page_fault_count_before
+    void UpdateMemoryStats (size_t page_fault_count_before);
 };
 
 } // namespace transport_router